@@ -39,6 +39,10 @@ public:
 	forceinline constexpr std::string GetUciPromotionPiece()		const;
 	forceinline constexpr bool		  IsKingsideCastling()			const { return GetMoveType() == MoveType::KINGSIDE_CASTLING; }
 	forceinline constexpr bool		  IsQueensideCastling()			const { return GetMoveType() == MoveType::QUEENSIDE_CASTLING; }
+	forceinline constexpr bool		  IsCapture()					const;
+	forceinline constexpr bool		  IsPromotion()					const { return GetMoveType() >= MoveType::PROMOTION_TO_QUEEN; }
+	// from, to and promotion piece are enough to tell apart all legal moves in a position
+	forceinline constexpr uint16_t	  ToPackedMove()				const { return uint16_t(m_EncodedMove & (INDEX_FROM_BITMASK | INDEX_TO_BITMASK)) | uint16_t(PromotionPieceType() << 12); }
 	forceinline constexpr bool		  operator==(const Move& other) const { return m_EncodedMove == other.m_EncodedMove; }
 	forceinline constexpr explicit	  operator bool()				const;
 
@@ -71,6 +75,12 @@ forceinline constexpr std::string Move::GetUciPromotionPiece() const
 	}
 }
 
+forceinline constexpr bool Move::IsCapture() const
+{
+	const MoveType moveType = GetMoveType();
+	return moveType == MoveType::CAPTURE || moveType == MoveType::EN_PASSANT || moveType >= MoveType::PROMOTION_TO_QUEEN_AND_CAPTURE;
+}
+
 inline static constexpr Move NULL_MOVE = Move();
 
 forceinline constexpr Move::operator bool() const
@@ -71,6 +71,8 @@ struct Position
 	forceinline static Position& MakeMove(const Position& pos, Position& newPos, const Move& move);
 
 	forceinline static Position& MakeMove(const Position& pos, Position& newPos, const Move& move);
+	template<Color sideToMove>
+	forceinline static Position& MakeNullMove(const Position& pos, Position& newPos);
 	forceinline static Position ParseFen(const std::string_view fen);
 	forceinline static void PrintBoard(const Position& currPos);
 };
@@ -573,6 +575,35 @@ forceinline Position& Position::MakeMove(const Position& pos, Position& newPos,
 	}
 }
 
+// passes the turn without moving, only the side to move, the en passant square and the fifty move counter change
+template<Color sideToMove>
+forceinline Position& Position::MakeNullMove(const Position& pos, Position& newPos)
+{
+	ValidateColor<sideToMove>();
+	constexpr Color oppositeColor = GetOppositeColor<sideToMove>();
+
+	newPos.WhitePieces = pos.WhitePieces;
+	newPos.BlackPieces = pos.BlackPieces;
+	newPos.OccupiedBitmask = pos.OccupiedBitmask;
+	newPos.CastlingPermissions = pos.CastlingPermissions;
+	newPos.Hash = pos.Hash;
+
+	newPos.Hash ^= ZOBRIST_SIDE_TO_MOVE_KEY;
+	newPos.SideToMove = oppositeColor;
+	newPos.FiftyMoveRule = pos.FiftyMoveRule + 1;
+
+	newPos.EnPassantSquare = 0ULL;
+	if (pos.EnPassantSquare)
+	{
+		newPos.Hash ^= ZOBRIST_EN_PASSANT_KEYS[BitIndex(pos.EnPassantSquare)];
+		newPos.Hash ^= ZOBRIST_EN_PASSANT_KEYS[BitIndex<0>()];
+	}
+
+	DEBUG_ASSERT(newPos.Hash == newPos.CalculateHash());
+
+	return newPos;
+}
+
 template<Color sideToMove>
 forceinline constexpr char GetPieceChar(const Side& side, const Bitboard bit)
 {
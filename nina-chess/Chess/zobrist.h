@@ -3,28 +3,28 @@
 #include "Chess/piece.h"
 #include <cstdint>
 
-inline constexpr uint64_t ZOBRIST_SIDE_TO_MOVE_KEY = 0x6969696969ULL;
+inline constexpr uint64_t ZOBRIST_SIDE_TO_MOVE_KEY = 15839171141866177398ULL;
 
 inline constexpr uint64_t ZOBRIST_CASTLING_KEYS[0b10000] = 
 {
-	0x69, 0x6969, 0x696969, 0x69696969,
-	0x45, 0x4545, 0x454545, 0x45454545,
-	0x11, 0x1111, 0x111111, 0x11111111,
-	0x1337, 0x13371337, 0x133713371337, 0x1337133713371337
+	868782759628727571ULL, 16423653378963752711ULL, 5598022798596614102ULL, 6391540231707180285ULL,
+	8271944675851334207ULL, 7874996232820208989ULL, 7648740437613231117ULL, 6967879983289632173ULL,
+	6902842723040713895ULL, 2288334834022816133ULL, 15354238652640727365ULL, 11330191865928962071ULL,
+	8560321243526118360ULL, 12359016574240773064ULL, 17512237347548345527ULL, 11836071627323371654ULL
 };
 
 inline constexpr uint64_t ZOBRIST_EN_PASSANT_KEYS[NUM_BOARD_SQUARES + 1] =
 {
 	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL,
 	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL,
-	9, 99, 99, 9999, 99999, 999999, 99999999, 999999999,
+	7472427110507943459ULL, 12794078354556018145ULL, 982747664758384616ULL, 17003076910742848905ULL, 1263203064869444715ULL, 13598712912155710826ULL, 9977354785176271196ULL, 4497244315080217260ULL,
 	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL,
 	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL,
-	0x09, 0x099, 0x099, 0x09999, 0x099999, 0x0999999, 0x099999999, 0x0999999999,
+	16009336187401942331ULL, 2135504841619576056ULL, 7192366418477076865ULL, 9286314289072225902ULL, 7089286429773460144ULL, 6522312101006319009ULL, 8157578065381110209ULL, 9987648088090340640ULL,
 	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL,
 	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL,
 	// no en pasant
-	0x1234567891011ULL
+	2503559678931920862ULL
 };
 
 inline constexpr uint64_t ZOBRIST_PIECE_KEYS[NUM_BOARD_SQUARES][PIECE_NONE] = {
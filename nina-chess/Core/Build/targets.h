@@ -15,4 +15,9 @@
 #ifdef _GAMEGEN
 #undef _UCI
 #define _UCI false
+#endif
+
+#ifdef _DATATOOL
+#undef _UCI
+#define _UCI false
 #endif
\ No newline at end of file
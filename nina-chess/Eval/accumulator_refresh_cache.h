@@ -0,0 +1,73 @@
+#pragma once
+#include "Chess/board_features.h"
+#include "Chess/chess_constants.h"
+#include "Chess/position.h"
+#include "Chess/side.h"
+#include "Core/Engine/utils.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
+#include "Hardware/architecture.h"
+#include "Hardware/intrinsics.h"
+#include "MoveGen/move_list.h"
+#include <cstdint>
+
+// the last accumulator refreshed for every white king square, together with copies of the features it was computed from
+// a refresh of a position in the same bucket is a diff against that state instead of a sum over every active feature,
+// consecutive resets (the next move of a game, the next position command) mostly share the king square and most features
+template<typename AccumulatorType>
+class AccumulatorRefreshCache
+{
+public:
+	inline static constexpr size_t NUM_BUCKETS = NUM_BOARD_SQUARES;
+	// float error builds up along a chain of diffs, every so often an entry is rebuilt from scratch
+	inline static constexpr uint32_t MAX_DIFFS_BEFORE_RESET = 16;
+
+	forceinline constexpr AccumulatorRefreshCache() : m_Entries{} {}
+
+	// the accumulator has to have its weights set, the cache copies it and never touches the weights itself
+	forceinline constexpr void Refresh(const Position& position, const MoveList& moveList, AccumulatorType& accumulator);
+
+private:
+	struct Entry
+	{
+		AccumulatorType Accumulator;
+		Side WhitePieces;
+		Side BlackPieces;
+		BoardFeatures Features;
+		MoveListMiscellaneous MoveListMisc;
+		uint32_t NumDiffs;
+		bool IsValid;
+	};
+
+	forceinline static constexpr size_t getBucket(const Position& position) { return Tzcnt(position.WhitePieces.King) % NUM_BUCKETS; }
+
+	alignas(CACHE_LINE_SIZE) Entry m_Entries[NUM_BUCKETS];
+};
+
+
+template<typename AccumulatorType>
+forceinline constexpr void AccumulatorRefreshCache<AccumulatorType>::Refresh(const Position& position, const MoveList& moveList, AccumulatorType& accumulator)
+{
+	Entry& entry = m_Entries[getBucket(position)];
+
+	const BoardFeatures newFeatures = { &position.WhitePieces, &position.BlackPieces, position.EnPassantSquare, position.CastlingPermissions };
+	const auto newFeaturesIterator = ChessBitboardFeatureIterator(newFeatures, moveList.MoveListMisc);
+
+	if (entry.IsValid && entry.NumDiffs < MAX_DIFFS_BEFORE_RESET)
+	{
+		const auto oldFeaturesIterator = ChessBitboardFeatureIterator(entry.Features, entry.MoveListMisc);
+		accumulator.AccumulateFeatures(newFeaturesIterator, oldFeaturesIterator, entry.Accumulator.GetOutput());
+		entry.NumDiffs++;
+	}
+	else
+	{
+		accumulator.Reset(newFeaturesIterator);
+		entry.NumDiffs = 0;
+	}
+
+	entry.Accumulator = accumulator;
+	entry.WhitePieces = position.WhitePieces;
+	entry.BlackPieces = position.BlackPieces;
+	entry.Features = { &entry.WhitePieces, &entry.BlackPieces, position.EnPassantSquare, position.CastlingPermissions };
+	entry.MoveListMisc = moveList.MoveListMisc;
+	entry.IsValid = true;
+}
@@ -2,12 +2,17 @@
 #include "Chess/color.h"
 #include "Chess/position.h"
 #include "Core/Engine/utils.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
 #include "Eval/psqt.h"
 #include "Eval/score.h"
+#include "Hardware/architecture.h"
 #include "MoveGen/move_list.h"
+#include "NN/dense_layer.h"
 #include "Search/position_stack.h"
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <string_view>
 
 class Evaluator
@@ -18,16 +23,41 @@ public:
 	
 	template<Color sideToMove>
 	forceinline constexpr Score Evaluate(const MoveList& moveList, const int64_t searchDepth);
+	// only the network, for when the move list can't tell whether the position is terminal
+	template<Color sideToMove>
+	forceinline constexpr Score EvaluateStatic();
 
+	// cheap, the network is only brought up to date by the next Evaluate, plies that never evaluate cost nothing
+	// newPos and moveList are read at that point, they have to stay in place until the matching UndoUpdate
 	template<Color sideToMove>
 	forceinline constexpr void IncrementalUpdate(const Position& newPos, const MoveList& moveList);
 
+	// offline evaluation of many positions at once, e.g. rescoring PositionEntry files, nothing is updated incrementally
+	// features holds NUM_FEATURE_BITBOARDS bitboards per position, laid out like PositionEntry::Features
+	// outputs receives the white relative win/draw/loss chances of every position
+	forceinline void EvaluateBatch(const Bitboard* features, const size_t batch, float* outputs);
+
 	forceinline constexpr void UndoUpdate() { m_PSQT.UndoUpdate(); m_Depth--; }
 	forceinline constexpr void Reset(PositionStack& positionStack);
 
+	inline static constexpr size_t NUM_FEATURE_BITBOARDS = ChessBitboardFeatureIterator::NumBitboardFeatures();
+
 private:
+	// the psqt is a single dense layer over the feature bits, seen that way it can go through DenseLayer::ForwardBatch
+	inline static constexpr int NUM_BATCH_INPUTS = int(NUM_FEATURE_BITBOARDS * PSQT::AccumulatorType::BITS_IN_BITBOARD);
+	inline static constexpr size_t EVALUATION_BATCH_SIZE = 64;
+	using BatchLayer = DenseLayer<NUM_BATCH_INPUTS, int(PSQT::ACCUMULATOR_OUTPUT_SIZE), ActivationFunction::RELU>;
+
+	struct BatchInputs
+	{
+		alignas(CACHE_LINE_SIZE) float Values[EVALUATION_BATCH_SIZE][NUM_BATCH_INPUTS];
+	};
+
 	int m_Depth;
 	PSQT m_PSQT;
+	// only allocated once EvaluateBatch is used, search never needs them
+	std::unique_ptr<BatchLayer> m_BatchLayer;
+	std::unique_ptr<BatchInputs> m_BatchInputs;
 };
 
 
@@ -74,6 +104,46 @@ forceinline constexpr void Evaluator::Reset(PositionStack& positionStack)
 	}
 }
 
+forceinline void Evaluator::EvaluateBatch(const Bitboard* features, const size_t batch, float* outputs)
+{
+	static_assert(PSQT::ACCUMULATOR_OUTPUT_SIZE == 1, "EvaluateBatch writes one output per position");
+
+	if (!m_BatchLayer)
+	{
+		const auto& psqtWeights = m_PSQT.GetWeights();
+		m_BatchLayer = std::make_unique<BatchLayer>();
+		m_BatchLayer->SetWeights(&psqtWeights.Weights[0][0], psqtWeights.Bias);
+		m_BatchInputs = std::make_unique<BatchInputs>();
+	}
+
+	for (size_t chunkStart = 0; chunkStart < batch; chunkStart += EVALUATION_BATCH_SIZE)
+	{
+		const size_t chunkSize = std::min(EVALUATION_BATCH_SIZE, batch - chunkStart);
+
+		// the inputs are the feature bits themselves, relu leaves the 0s and 1s as they are
+		std::memset(m_BatchInputs->Values, 0, chunkSize * sizeof(m_BatchInputs->Values[0]));
+		for (size_t positionIndex = 0; positionIndex < chunkSize; positionIndex++)
+		{
+			const Bitboard* positionFeatures = &features[(chunkStart + positionIndex) * NUM_FEATURE_BITBOARDS];
+			float* positionInputs = m_BatchInputs->Values[positionIndex];
+			for (size_t bitboardIndex = 0; bitboardIndex < NUM_FEATURE_BITBOARDS; bitboardIndex++)
+			{
+				Bitboard bitboard = positionFeatures[bitboardIndex];
+				while (bitboard)
+				{
+					positionInputs[bitboardIndex * PSQT::AccumulatorType::BITS_IN_BITBOARD + PopBitAndGetIndex(bitboard)] = 1.f;
+				}
+			}
+		}
+
+		m_BatchLayer->ForwardBatch(&m_BatchInputs->Values[0][0], chunkSize, &outputs[chunkStart]);
+		for (size_t positionIndex = 0; positionIndex < chunkSize; positionIndex++)
+		{
+			outputs[chunkStart + positionIndex] = PSQT::Activate(outputs[chunkStart + positionIndex]);
+		}
+	}
+}
+
 template<Color sideToMove>
 forceinline constexpr Score Evaluator::Evaluate(const MoveList& moveList, const int64_t searchDepth)
 {
@@ -92,6 +162,13 @@ forceinline constexpr Score Evaluator::Evaluate(const MoveList& moveList, const
 		}
 	}
 
+	return EvaluateStatic<sideToMove>();
+}
+
+template<Color sideToMove>
+forceinline constexpr Score Evaluator::EvaluateStatic()
+{
+	ValidateColor<sideToMove>();
 	Score score = GetScore(m_PSQT.Evaluate() * (sideToMove == Color::WHITE ? 1 : -1));
 	ValidateScore(score);
 
@@ -0,0 +1,87 @@
+#pragma once
+#include "Chess/color.h"
+#include "Chess/move.h"
+#include "Chess/position.h"
+#include "Core/Engine/rng.h"
+#include "Eval/evaluator.h"
+#include "Eval/score.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/rescore.h"
+#include "MoveGen/move_list.h"
+#include "Search/position_stack.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// EvaluateBatch has to reproduce what the incrementally updated evaluator says about the same positions,
+// and rescoring has to turn that into the side to move relative score search would have seen
+inline bool TestEvaluateBatch()
+{
+	constexpr int NUM_GAMES = 16;
+	constexpr int MAX_GAME_LENGTH = 80;
+	// float sums in a different order, the scores may round the other way
+	constexpr int32_t MAX_SCORE_DIFFERENCE = 1;
+
+	std::cout << "Running evaluate batch test\n";
+
+	auto positionStack = std::make_unique<PositionStack>();
+	Evaluator evaluator;
+	Xorshift64 rng(0xBA7C4);
+
+	std::vector<PositionEntry> entries;
+	std::vector<Score> whiteScores;
+	std::vector<Score> sideToMoveScores;
+	for (int game = 0; game < NUM_GAMES; game++)
+	{
+		positionStack->Reset(Position());
+		evaluator.Reset(*positionStack);
+		for (int ply = 0; ply < MAX_GAME_LENGTH; ply++)
+		{
+			const Position& position = positionStack->GetCurrentPosition();
+			MoveList& moveList = positionStack->GetMoveList();
+			if (moveList.GetNumMoves() == 0)
+				break;
+
+			std::uniform_int_distribution<uint32_t> moveDist(0, moveList.GetNumMoves() - 1);
+			const Move move = moveList[moveDist(rng)];
+			entries.push_back(PackPosition(position, moveList.MoveListMisc, Score::UNKNOWN, move));
+			whiteScores.push_back(evaluator.EvaluateStatic<WHITE>());
+			sideToMoveScores.push_back(position.SideToMove == WHITE ? evaluator.EvaluateStatic<WHITE>() : evaluator.EvaluateStatic<BLACK>());
+
+			const Color sideToMove = position.SideToMove;
+			positionStack->MakeMove(move);
+			if (sideToMove == WHITE)
+				evaluator.IncrementalUpdate<WHITE>(positionStack->GetCurrentPosition(), positionStack->GetMoveList());
+			else
+				evaluator.IncrementalUpdate<BLACK>(positionStack->GetCurrentPosition(), positionStack->GetMoveList());
+		}
+	}
+
+	std::vector<Bitboard> features(entries.size() * Evaluator::NUM_FEATURE_BITBOARDS);
+	for (size_t entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+		std::memcpy(&features[entryIndex * Evaluator::NUM_FEATURE_BITBOARDS], entries[entryIndex].Features, sizeof(entries[entryIndex].Features));
+	// the same evaluator, every one loads the weights with its own small random jitter
+	std::vector<float> wdlChances(entries.size());
+	evaluator.EvaluateBatch(features.data(), entries.size(), wdlChances.data());
+	RescorePositionEntries(evaluator, entries.data(), entries.size());
+
+	for (size_t entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+	{
+		const int32_t batchDifference = std::abs(int32_t(GetScore(wdlChances[entryIndex])) - int32_t(whiteScores[entryIndex]));
+		const int32_t rescoreDifference = std::abs(int32_t(entries[entryIndex].SearchScore) - int32_t(sideToMoveScores[entryIndex]));
+		if (batchDifference > MAX_SCORE_DIFFERENCE || rescoreDifference > MAX_SCORE_DIFFERENCE)
+		{
+			std::cout << "Evaluate batch test failed: position " << entryIndex << " batch " << GetScore(wdlChances[entryIndex])
+				<< " rescored " << entries[entryIndex].SearchScore << ", incremental white " << whiteScores[entryIndex]
+				<< " side to move " << sideToMoveScores[entryIndex] << std::endl;
+			return false;
+		}
+	}
+
+	std::cout << "Evaluate batch test passed: " << entries.size() << " positions" << std::endl;
+	return true;
+}
@@ -2,6 +2,7 @@
 #include "Chess/board_features.h"
 #include "Chess/position.h"
 #include "Core/Engine/utils.h"
+#include "Eval/accumulator_refresh_cache.h"
 #include "Eval/chess_bitboard_feature_iterator.h"
 #include "Hardware/architecture.h"
 #include "MoveGen/move_list.h"
@@ -20,12 +21,17 @@ public:
 	forceinline PSQT(std::ifstream& weightsFile);
 
 	forceinline constexpr void Reset(const Position& position, const MoveList& moveList);
+	// only records the features of the new ply, the accumulator is computed once the ply is evaluated
 	forceinline constexpr void IncrementalUpdate(const Position& position, const MoveList& moveList);
 	forceinline constexpr void UndoUpdate() { m_Depth--; }
-	forceinline float Evaluate() { return std::tanh(m_Accumulators[m_Depth].GetOutput()[0] / 16.f); }
+	forceinline float Evaluate() { materialize(); return Activate(m_Accumulators[m_Depth].GetOutput()[0]); }
+	forceinline const AccumulatorType::Weights& GetWeights() const { return m_AccumulatorContext.AccumulatorWeights; }
+	// the output activation, applied to the accumulator output by Evaluate
+	forceinline static float Activate(const float accumulatorOutput) { return std::tanh(accumulatorOutput / 16.f); }
 
 private:
 	forceinline constexpr void update(const Position& position, const MoveList& moveList);
+	forceinline constexpr void materialize();
 
 	struct AccumulatorContext
 	{
@@ -35,7 +41,10 @@ private:
 	alignas(CACHE_LINE_SIZE) const MoveListMiscellaneous* m_MovesMiscellaneousBitmasks[MAX_PLY];
 	alignas(CACHE_LINE_SIZE) BoardFeatures m_BoardFeatures[MAX_PLY];
 	alignas(CACHE_LINE_SIZE) AccumulatorContext m_AccumulatorContext;
+	AccumulatorRefreshCache<AccumulatorType> m_RefreshCache;
 	alignas(CACHE_LINE_SIZE) AccumulatorType m_Accumulators[MAX_PLY];
+	// plies whose accumulator is up to date, the root always is
+	bool m_IsComputed[MAX_PLY];
 	int m_Depth;
 };
 
@@ -49,7 +58,9 @@ PSQT::PSQT(std::ifstream& weightsFile) :
 	m_MovesMiscellaneousBitmasks{},
 	m_BoardFeatures{},
 	m_AccumulatorContext{},
+	m_RefreshCache{},
 	m_Accumulators{},
+	m_IsComputed{},
 	m_Depth{ 0 }
 {
 	m_AccumulatorContext.AccumulatorWeights.SetWeights(weightsFile);
@@ -65,30 +76,43 @@ forceinline constexpr void PSQT::Reset(const Position& position, const MoveList&
 	m_Depth = 0;
 	update(position, moveList);
 
-	const auto& currentFeatures = m_BoardFeatures[m_Depth];
-	const auto& currentMoveListMiscellaneous = *m_MovesMiscellaneousBitmasks[m_Depth];
-	const auto& featuresIterator = ChessBitboardFeatureIterator(currentFeatures, currentMoveListMiscellaneous);
-
-	m_Accumulators[m_Depth].Reset(featuresIterator);
+	m_RefreshCache.Refresh(position, moveList, m_Accumulators[m_Depth]);
+	m_IsComputed[m_Depth] = true;
 }
 
 forceinline constexpr void PSQT::IncrementalUpdate(const Position& position, const MoveList& moveList)
 {
 	m_Depth++;
 	update(position, moveList);
+	m_IsComputed[m_Depth] = false;
+}
+
+forceinline constexpr void PSQT::materialize()
+{
+	if (m_IsComputed[m_Depth])
+		return;
+
+	// the accumulator diffs whole feature sets, so it can go straight from the last computed ply to this one
+	// the plies in between are left uncomputed, most of them are never evaluated
+	int computedDepth = m_Depth - 1;
+	while (!m_IsComputed[computedDepth])
+	{
+		computedDepth--;
+	}
 
-	const auto& oldBoardFeatures = m_BoardFeatures[m_Depth - 1];
+	const auto& oldBoardFeatures = m_BoardFeatures[computedDepth];
 	const auto& newBoardFeatures = m_BoardFeatures[m_Depth];
 
-	const auto& oldMoveListMiscellaneous = *m_MovesMiscellaneousBitmasks[m_Depth - 1];
+	const auto& oldMoveListMiscellaneous = *m_MovesMiscellaneousBitmasks[computedDepth];
 	const auto& newMoveListMiscellaneous = *m_MovesMiscellaneousBitmasks[m_Depth];
 
 	const auto oldFeaturesIterator = ChessBitboardFeatureIterator(oldBoardFeatures, oldMoveListMiscellaneous);
 	const auto newFeaturesIterator = ChessBitboardFeatureIterator(newBoardFeatures, newMoveListMiscellaneous);
 
-	const auto& oldAccumulator = m_Accumulators[m_Depth - 1];
+	const auto& oldAccumulator = m_Accumulators[computedDepth];
 
 	m_Accumulators[m_Depth].AccumulateFeatures(newFeaturesIterator, oldFeaturesIterator, oldAccumulator.GetOutput());
+	m_IsComputed[m_Depth] = true;
 }
 
 forceinline constexpr void PSQT::update(const Position& position, const MoveList& moveList)
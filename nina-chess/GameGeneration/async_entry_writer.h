@@ -0,0 +1,354 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include "GameGeneration/generation_checkpoint.h"
+#include "GameGeneration/packed_data.h"
+#include "GameGeneration/position_entry.h"
+#include "Hardware/file_sync.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// finished games on their way to the output file, owned by a worker and lent to the writer while it is queued
+struct EntryWriteBuffer
+{
+	std::vector<PositionEntry> Entries;
+	// what gets written instead of Entries when the output is packed, filled by the worker so the writer only does io
+	std::vector<uint8_t> PackedBytes;
+	// the games in Entries, for the checkpoint
+	std::vector<int> GameIndices;
+	std::atomic<bool> IsFree = true;
+	EntryWriteBuffer* Next = nullptr;
+};
+
+// a single thread does all the output file io, workers hand it filled buffers and keep playing games
+// the queue is an intrusive lock free stack that the writer empties in one exchange and reverses, so many workers can push
+// while the writer never blocks them, and every worker's buffers are still written in the order they were submitted
+// with a checkpoint the writer also keeps its manifest up to date, it is the one thread that knows what is on disk
+class AsyncEntryWriter
+{
+public:
+	// a checkpoint that already has FlushedBytes is resumed, the file is cut back to that offset and appended to
+	forceinline AsyncEntryWriter(const std::string& filename, const bool isPackedOutput,
+		GenerationCheckpoint* checkpoint = nullptr, const int checkpointIntervalSeconds = 0);
+	forceinline ~AsyncEntryWriter() { Stop(); }
+
+	AsyncEntryWriter(const AsyncEntryWriter&) = delete;
+	AsyncEntryWriter& operator=(const AsyncEntryWriter&) = delete;
+
+	forceinline bool IsOpen() const { return m_File.is_open(); }
+	forceinline bool IsPackedOutput() const { return m_IsPackedOutput; }
+	forceinline bool HasFailed() const { return m_HasFailed.load(std::memory_order_acquire); }
+	forceinline double GetWriteSeconds() const { return double(m_WriteNanoseconds.load()) * 1e-9; }
+	// what the file holds, only to be read once the writer is stopped
+	forceinline uint64_t GetNumBytesWritten() const { return m_BytesWritten; }
+	forceinline uint64_t GetNumEntriesWritten() const { return m_EntriesWritten; }
+	// with a checkpoint, games shouldn't wait in a worker's buffer longer than this or a crash loses them despite checkpointing
+	forceinline bool IsCheckpointing() const { return m_Checkpoint != nullptr; }
+	forceinline std::chrono::seconds GetCheckpointInterval() const { return m_CheckpointInterval; }
+
+	// the buffer is marked free again once written, until then the caller must leave it alone
+	forceinline void Submit(EntryWriteBuffer& buffer);
+	// writes everything submitted so far and closes the file, submitting afterwards isn't allowed
+	forceinline void Stop();
+	forceinline void RethrowIfFailed() const;
+
+private:
+	forceinline void push(EntryWriteBuffer& buffer);
+	forceinline void run();
+	forceinline void write(EntryWriteBuffer& buffer);
+	forceinline void saveCheckpoint();
+
+	const std::string m_Filename;
+	std::ofstream m_File;
+	const bool m_IsPackedOutput;
+	GenerationCheckpoint* m_Checkpoint;
+	const std::chrono::seconds m_CheckpointInterval;
+	std::chrono::steady_clock::time_point m_LastCheckpointTime;
+	uint64_t m_BytesWritten = 0;
+	uint64_t m_EntriesWritten = 0;
+	std::atomic<EntryWriteBuffer*> m_QueueHead = nullptr;
+	// pushed by Stop, the writer exits once it gets to it
+	EntryWriteBuffer m_StopBuffer;
+	std::atomic<bool> m_HasFailed = false;
+	std::exception_ptr m_Exception;
+	std::atomic<int64_t> m_WriteNanoseconds = 0;
+	std::thread m_Thread;
+};
+
+// the pair of buffers a worker alternates between, one is filled while the writer has the other
+class DoubleEntryBuffer
+{
+public:
+	// time spent waiting for the writer to give a buffer back is added to blockedNanoseconds,
+	// everything else the writer does overlaps with playing games
+	forceinline DoubleEntryBuffer(AsyncEntryWriter& writer, const size_t capacity, std::atomic<int64_t>& blockedNanoseconds);
+	// a buffer the writer still has is waited for, it can't be freed from under it
+	forceinline ~DoubleEntryBuffer() { waitUntilFree(m_Buffers[0]); waitUntilFree(m_Buffers[1]); }
+
+	DoubleEntryBuffer(const DoubleEntryBuffer&) = delete;
+	DoubleEntryBuffer& operator=(const DoubleEntryBuffer&) = delete;
+
+	forceinline void Append(const std::vector<PositionEntry>& game, const int gameIndex);
+	forceinline void Flush();
+
+private:
+	forceinline void handOff();
+	forceinline void waitUntilFree(EntryWriteBuffer& buffer);
+	forceinline bool isCurrentBufferDue() const;
+
+	AsyncEntryWriter& m_Writer;
+	const size_t m_Capacity;
+	std::chrono::steady_clock::time_point m_LastHandOffTime;
+	EntryWriteBuffer m_Buffers[2];
+	size_t m_CurrentBuffer = 0;
+	std::atomic<int64_t>& m_BlockedNanoseconds;
+};
+
+
+forceinline AsyncEntryWriter::AsyncEntryWriter(const std::string& filename, const bool isPackedOutput,
+	GenerationCheckpoint* checkpoint, const int checkpointIntervalSeconds) :
+	m_Filename(filename),
+	m_IsPackedOutput(isPackedOutput),
+	m_Checkpoint(checkpoint),
+	m_CheckpointInterval(checkpointIntervalSeconds),
+	m_LastCheckpointTime(std::chrono::steady_clock::now())
+{
+	const bool isResuming = m_Checkpoint && m_Checkpoint->FlushedBytes;
+	if (isResuming)
+	{
+		// anything past the checkpoint is games that aren't in the manifest, they will be played again
+		if (std::filesystem::file_size(filename) < m_Checkpoint->FlushedBytes)
+			throw std::runtime_error(filename + " is shorter than its checkpoint, it can't be resumed");
+		std::filesystem::resize_file(filename, m_Checkpoint->FlushedBytes);
+		m_File.open(filename, std::ios::binary | std::ios::app);
+		m_BytesWritten = m_Checkpoint->FlushedBytes;
+		m_EntriesWritten = m_Checkpoint->FlushedEntries;
+	}
+	else
+		m_File.open(filename, std::ios::binary);
+
+	if (!m_File.is_open())
+		return;
+
+	if (m_IsPackedOutput && !isResuming)
+	{
+		WritePackedDataHeader(m_File);
+		m_BytesWritten = sizeof(PackedDataHeader);
+	}
+	if (m_Checkpoint)
+		saveCheckpoint();
+	m_Thread = std::thread([this]() { run(); });
+}
+
+forceinline void AsyncEntryWriter::Submit(EntryWriteBuffer& buffer)
+{
+	buffer.IsFree.store(false, std::memory_order_relaxed);
+	push(buffer);
+}
+
+forceinline void AsyncEntryWriter::Stop()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	push(m_StopBuffer);
+	m_Thread.join();
+
+	m_File.close();
+	if (m_File.fail() && !m_HasFailed)
+	{
+		m_Exception = std::make_exception_ptr(std::runtime_error("failed writing the game generation output"));
+		m_HasFailed.store(true, std::memory_order_release);
+	}
+
+	if (m_Checkpoint && !m_HasFailed)
+	{
+		try
+		{
+			saveCheckpoint();
+		}
+		catch (...)
+		{
+			m_Exception = std::current_exception();
+			m_HasFailed.store(true, std::memory_order_release);
+		}
+	}
+}
+
+forceinline void AsyncEntryWriter::RethrowIfFailed() const
+{
+	if (HasFailed())
+		std::rethrow_exception(m_Exception);
+}
+
+forceinline void AsyncEntryWriter::push(EntryWriteBuffer& buffer)
+{
+	EntryWriteBuffer* head = m_QueueHead.load(std::memory_order_relaxed);
+	do
+	{
+		buffer.Next = head;
+	} while (!m_QueueHead.compare_exchange_weak(head, &buffer, std::memory_order_release, std::memory_order_relaxed));
+	m_QueueHead.notify_one();
+}
+
+forceinline void AsyncEntryWriter::run()
+{
+	while (true)
+	{
+		m_QueueHead.wait(nullptr, std::memory_order_acquire);
+		EntryWriteBuffer* pushed = m_QueueHead.exchange(nullptr, std::memory_order_acquire);
+
+		// the stack holds the newest buffer first
+		EntryWriteBuffer* oldestFirst = nullptr;
+		while (pushed)
+		{
+			EntryWriteBuffer* next = pushed->Next;
+			pushed->Next = oldestFirst;
+			oldestFirst = pushed;
+			pushed = next;
+		}
+
+		bool isStopping = false;
+		while (oldestFirst)
+		{
+			EntryWriteBuffer* buffer = oldestFirst;
+			oldestFirst = buffer->Next;
+			if (buffer == &m_StopBuffer)
+			{
+				isStopping = true;
+				continue;
+			}
+
+			write(*buffer);
+			buffer->IsFree.store(true, std::memory_order_release);
+			buffer->IsFree.notify_one();
+		}
+
+		if (isStopping)
+			return;
+	}
+}
+
+forceinline void AsyncEntryWriter::write(EntryWriteBuffer& buffer)
+{
+	// after a failure buffers are still handed back, workers would wait on them forever otherwise
+	if (HasFailed())
+		return;
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	if (m_IsPackedOutput)
+		m_File.write(reinterpret_cast<const char*>(buffer.PackedBytes.data()), static_cast<std::streamsize>(buffer.PackedBytes.size()));
+	else
+		m_File.write(reinterpret_cast<const char*>(buffer.Entries.data()), static_cast<std::streamsize>(buffer.Entries.size() * sizeof(PositionEntry)));
+	m_WriteNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	if (m_File.fail())
+	{
+		m_Exception = std::make_exception_ptr(std::runtime_error("failed writing the game generation output"));
+		m_HasFailed.store(true, std::memory_order_release);
+		return;
+	}
+
+	m_BytesWritten += m_IsPackedOutput ? buffer.PackedBytes.size() : buffer.Entries.size() * sizeof(PositionEntry);
+	m_EntriesWritten += buffer.Entries.size();
+	if (!m_Checkpoint)
+		return;
+
+	for (const int gameIndex : buffer.GameIndices)
+		m_Checkpoint->CompletedGames.Add(gameIndex);
+	if (std::chrono::steady_clock::now() - m_LastCheckpointTime < m_CheckpointInterval)
+		return;
+
+	try
+	{
+		saveCheckpoint();
+	}
+	catch (...)
+	{
+		m_Exception = std::current_exception();
+		m_HasFailed.store(true, std::memory_order_release);
+	}
+}
+
+forceinline void AsyncEntryWriter::saveCheckpoint()
+{
+	// the data the checkpoint covers goes to the disk first, the file is already closed once the writer is stopped
+	if (m_File.is_open())
+	{
+		m_File.flush();
+		if (m_File.fail())
+			throw std::runtime_error("failed writing the game generation output");
+	}
+	SyncFile(m_Filename);
+
+	m_Checkpoint->FlushedBytes = m_BytesWritten;
+	m_Checkpoint->FlushedEntries = m_EntriesWritten;
+	m_Checkpoint->Save(m_Filename);
+	m_LastCheckpointTime = std::chrono::steady_clock::now();
+}
+
+forceinline DoubleEntryBuffer::DoubleEntryBuffer(AsyncEntryWriter& writer, const size_t capacity, std::atomic<int64_t>& blockedNanoseconds) :
+	m_Writer(writer),
+	m_Capacity(capacity),
+	m_LastHandOffTime(std::chrono::steady_clock::now()),
+	m_BlockedNanoseconds(blockedNanoseconds)
+{
+	for (auto& buffer : m_Buffers)
+		buffer.Entries.reserve(capacity);
+}
+
+forceinline void DoubleEntryBuffer::Append(const std::vector<PositionEntry>& game, const int gameIndex)
+{
+	auto& buffer = m_Buffers[m_CurrentBuffer];
+	buffer.Entries.insert(buffer.Entries.end(), game.begin(), game.end());
+	buffer.GameIndices.push_back(gameIndex);
+	if (buffer.Entries.size() >= m_Capacity || isCurrentBufferDue())
+		handOff();
+}
+
+forceinline void DoubleEntryBuffer::Flush()
+{
+	if (!m_Buffers[m_CurrentBuffer].Entries.empty())
+		handOff();
+}
+
+forceinline void DoubleEntryBuffer::handOff()
+{
+	EntryWriteBuffer& filled = m_Buffers[m_CurrentBuffer];
+	if (m_Writer.IsPackedOutput())
+	{
+		filled.PackedBytes.clear();
+		AppendPackedChunks(filled.Entries, filled.PackedBytes);
+	}
+	m_Writer.Submit(filled);
+	m_LastHandOffTime = std::chrono::steady_clock::now();
+
+	m_CurrentBuffer ^= 1;
+	EntryWriteBuffer& next = m_Buffers[m_CurrentBuffer];
+	waitUntilFree(next);
+	next.Entries.clear();
+	next.GameIndices.clear();
+}
+
+forceinline void DoubleEntryBuffer::waitUntilFree(EntryWriteBuffer& buffer)
+{
+	if (buffer.IsFree.load(std::memory_order_acquire))
+		return;
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	while (!buffer.IsFree.load(std::memory_order_acquire))
+		buffer.IsFree.wait(false, std::memory_order_acquire);
+	m_BlockedNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+forceinline bool DoubleEntryBuffer::isCurrentBufferDue() const
+{
+	return m_Writer.IsCheckpointing() && std::chrono::steady_clock::now() - m_LastHandOffTime >= m_Writer.GetCheckpointInterval();
+}
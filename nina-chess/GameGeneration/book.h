@@ -6,8 +6,9 @@
 #include "Chess/side.h"
 #include "Core/Engine/rng.h"
 #include <Core/Engine/utils.h>
+#include "Hardware/mapped_file.h"
 #include <cstdint>
-#include <fstream>
+#include <cstring>
 #include <iostream>
 #include <random>
 #include <stdexcept>
@@ -22,6 +23,9 @@ struct BookPosition
 	uint32_t SideToMove;
 };
 
+// the file is memory mapped and positions are read straight out of the mapping, opening a book costs the same whatever its size
+// and every process generating games from the same book shares its pages through the page cache
+// only the positions games actually start from are ever paged in
 class Book
 {
 public:
@@ -42,33 +46,33 @@ private:
 	forceinline int getStartIndex(const int ply) const;
 	forceinline int getEndIndex(const int ply) const;
 
-	std::vector<BookPosition> m_Positions;
+	MappedFile m_File;
+	const BookPosition* m_Positions;
 	uint64_t m_SlotOffsets[NUM_SLOTS];
 	uint64_t m_FileSize;
 };
 
 
-forceinline Book::Book(const std::string& path)
+forceinline Book::Book(const std::string& path) :
+	m_File(path, FileAccess::RANDOM),
+	m_Positions(reinterpret_cast<const BookPosition*>(m_File.GetData() + HEADER_SIZE)),
+	m_FileSize(m_File.GetSize())
 {
-	std::ifstream file(path, std::ios::binary);
-	if (!file.is_open())
-		throw std::runtime_error("Failed to open book file: " + path);
+	if (m_FileSize < HEADER_SIZE)
+		throw std::runtime_error("Book file is too small to have a header: " + path);
+	std::memcpy(m_SlotOffsets, m_File.GetData(), sizeof(m_SlotOffsets));
 
-	// Read header
-	file.read(reinterpret_cast<char*>(m_SlotOffsets), sizeof(m_SlotOffsets));
-
-	// Get file size
-	file.seekg(0, std::ios::end);
-	m_FileSize = static_cast<uint64_t>(file.tellg());
-
-	// Read all positions
-	const uint64_t dataSize = m_FileSize - HEADER_SIZE;
-	const uint64_t numPositions = dataSize / sizeof(BookPosition);
+	// positions are indexed through the offsets without any further checks, so they have to stay inside the mapping
+	for (int slot = 0; slot < NUM_SLOTS; slot++)
+	{
+		const uint64_t previousOffset = slot ? m_SlotOffsets[slot - 1] : HEADER_SIZE;
+		if (m_SlotOffsets[slot] < previousOffset || m_SlotOffsets[slot] > m_FileSize ||
+			(m_SlotOffsets[slot] - HEADER_SIZE) % sizeof(BookPosition) != 0)
+			throw std::runtime_error("Book file has an invalid header: " + path);
+	}
 
-	m_Positions.resize(numPositions);
-	file.seekg(HEADER_SIZE);
-	file.read(reinterpret_cast<char*>(m_Positions.data()),
-		static_cast<std::streamsize>(dataSize));
+	const uint64_t numPositions = (m_FileSize - HEADER_SIZE) / sizeof(BookPosition);
+	m_FileSize = HEADER_SIZE + numPositions * sizeof(BookPosition);
 
 	std::cout << "Book loaded: " << path << std::endl;
 	std::cout << "  Total positions: " << numPositions << std::endl;
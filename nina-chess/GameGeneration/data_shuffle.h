@@ -0,0 +1,397 @@
+#pragma once
+#include "Core/Engine/rng.h"
+#include "Core/Engine/utils.h"
+#include "Eval/score.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/position_entry_reader.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// native replacement for scripts/shuffle_data.py that never holds the whole dataset in memory
+// 1. partition: every entry goes to a temporary bucket file picked by the hash of its features, so duplicates share a bucket
+// 2. deduplicate: buckets are loaded one per thread, duplicates are merged the way the script does it
+//    (SearchScore and Result averaged, BestMove and SideToMove kept from the first occurrence) and every unique entry
+//    is sent to a uniformly random shuffle block
+// 3. shuffle: blocks are loaded one at a time, Fisher-Yates shuffled and appended to the output
+// a random block per entry followed by a uniform shuffle of every block is a uniform shuffle of the whole output
+// the output is plain PositionEntry records back to back, the same format GameGenThreadWorker writes
+
+struct DataShuffleSettings
+{
+	std::vector<std::string> InputFiles;
+	std::string OutputFile;
+	// temporary files go to OutputFile + ".tmp" when empty
+	std::string TempDirectory;
+	size_t NumThreads = 1;
+	// roughly the most held in memory at once, buckets, blocks and the number of deduplicating threads are picked to fit it
+	// a warning tells when MAX_SHUFFLE_TEMP_FILES leaves buckets or blocks too large for it
+	size_t MemoryBudgetMB = 1024;
+	uint64_t Seed = 0;
+};
+
+// enough files to split terabytes of data into pieces that fit a modest budget, and still below common open file limits
+inline constexpr size_t MAX_SHUFFLE_TEMP_FILES = 512;
+inline constexpr size_t SHUFFLE_WRITE_BUFFER_ENTRIES = 1024;
+
+forceinline uint64_t HashPositionFeatures(const PositionEntry& entry)
+{
+	uint64_t hash = 0x9E3779B97F4A7C15ULL;
+	for (const uint64_t feature : entry.Features)
+	{
+		hash ^= feature + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+		hash *= 0xBF58476D1CE4E5B9ULL;
+	}
+	return hash ^ (hash >> 31);
+}
+
+// distinct well mixed seeds for every block and entry out of the one the user gave
+forceinline uint64_t GetShuffleSeed(const uint64_t seed, const uint64_t index)
+{
+	uint64_t mixed = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+	mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+	return mixed ^ (mixed >> 31);
+}
+
+forceinline int CompareFeatures(const PositionEntry& left, const PositionEntry& right)
+{
+	return std::memcmp(left.Features, right.Features, sizeof(PositionEntry::Features));
+}
+
+// entries buffered per file and appended in large writes, the files are shared between threads
+class PositionEntryFileSet
+{
+public:
+	forceinline PositionEntryFileSet(const std::filesystem::path& directory, const std::string& prefix, const size_t numFiles);
+
+	PositionEntryFileSet(const PositionEntryFileSet&) = delete;
+	PositionEntryFileSet& operator=(const PositionEntryFileSet&) = delete;
+
+	forceinline size_t GetNumFiles() const { return m_Paths.size(); }
+	forceinline const std::filesystem::path& GetPath(const size_t fileIndex) const { return m_Paths[fileIndex]; }
+
+	// buffers is one vector per file, owned by the calling thread
+	forceinline void Append(std::vector<std::vector<PositionEntry>>& buffers, const size_t fileIndex, const PositionEntry& entry);
+	forceinline void Flush(std::vector<std::vector<PositionEntry>>& buffers);
+	forceinline void Close();
+
+private:
+	forceinline void write(std::vector<PositionEntry>& buffer, const size_t fileIndex);
+
+	std::vector<std::filesystem::path> m_Paths;
+	std::vector<std::ofstream> m_Files;
+	std::vector<std::mutex> m_Mutexes;
+};
+
+
+forceinline PositionEntryFileSet::PositionEntryFileSet(const std::filesystem::path& directory, const std::string& prefix, const size_t numFiles) :
+	m_Files(numFiles),
+	m_Mutexes(numFiles)
+{
+	for (size_t fileIndex = 0; fileIndex < numFiles; fileIndex++)
+	{
+		m_Paths.push_back(directory / (prefix + std::to_string(fileIndex) + ".bin"));
+		m_Files[fileIndex].open(m_Paths.back(), std::ios::binary);
+		if (!m_Files[fileIndex].is_open())
+			throw std::runtime_error("could not open " + m_Paths.back().string() + " for writing");
+	}
+}
+
+forceinline void PositionEntryFileSet::Append(std::vector<std::vector<PositionEntry>>& buffers, const size_t fileIndex, const PositionEntry& entry)
+{
+	auto& buffer = buffers[fileIndex];
+	buffer.push_back(entry);
+	if (buffer.size() >= SHUFFLE_WRITE_BUFFER_ENTRIES)
+		write(buffer, fileIndex);
+}
+
+forceinline void PositionEntryFileSet::Flush(std::vector<std::vector<PositionEntry>>& buffers)
+{
+	for (size_t fileIndex = 0; fileIndex < buffers.size(); fileIndex++)
+		if (!buffers[fileIndex].empty())
+			write(buffers[fileIndex], fileIndex);
+}
+
+forceinline void PositionEntryFileSet::Close()
+{
+	for (size_t fileIndex = 0; fileIndex < m_Files.size(); fileIndex++)
+	{
+		m_Files[fileIndex].close();
+		if (m_Files[fileIndex].fail())
+			throw std::runtime_error("failed writing " + m_Paths[fileIndex].string());
+	}
+}
+
+forceinline void PositionEntryFileSet::write(std::vector<PositionEntry>& buffer, const size_t fileIndex)
+{
+	const std::lock_guard<std::mutex> lock(m_Mutexes[fileIndex]);
+	m_Files[fileIndex].write(reinterpret_cast<const char*>(buffer.data()),
+		static_cast<std::streamsize>(buffer.size() * sizeof(PositionEntry)));
+	if (m_Files[fileIndex].fail())
+		throw std::runtime_error("failed writing " + m_Paths[fileIndex].string());
+	buffer.clear();
+}
+
+inline std::vector<PositionEntry> ReadPositionEntries(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("could not open " + path.string());
+
+	std::vector<PositionEntry> entries(std::filesystem::file_size(path) / sizeof(PositionEntry));
+	file.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PositionEntry)));
+	if (file.fail())
+		throw std::runtime_error("failed reading " + path.string());
+	return entries;
+}
+
+// merges entries with identical features in place and returns the number of unique entries, which are moved to the front
+// rounding is to nearest even, like python's round in scripts/shuffle_data.py
+inline size_t DeduplicatePositionEntries(std::vector<PositionEntry>& entries)
+{
+	// stable, so the first entry of every run is the first occurrence in the input
+	std::stable_sort(entries.begin(), entries.end(), [](const PositionEntry& left, const PositionEntry& right)
+		{
+			return CompareFeatures(left, right) < 0;
+		});
+
+	size_t numUniqueEntries = 0;
+	for (size_t runStart = 0; runStart < entries.size();)
+	{
+		int64_t scoreSum = int32_t(entries[runStart].SearchScore);
+		int64_t resultSum = entries[runStart].Result;
+		size_t runEnd = runStart + 1;
+		for (; runEnd < entries.size() && CompareFeatures(entries[runStart], entries[runEnd]) == 0; runEnd++)
+		{
+			scoreSum += int32_t(entries[runEnd].SearchScore);
+			resultSum += entries[runEnd].Result;
+		}
+
+		PositionEntry& uniqueEntry = entries[numUniqueEntries++];
+		uniqueEntry = entries[runStart];
+		const double runLength = double(runEnd - runStart);
+		uniqueEntry.SearchScore = Score(int32_t(std::nearbyint(double(scoreSum) / runLength)));
+		uniqueEntry.Result = uint32_t(std::nearbyint(double(resultSum) / runLength));
+
+		runStart = runEnd;
+	}
+
+	return numUniqueEntries;
+}
+
+forceinline size_t GetNumShuffleTempFiles(const uint64_t dataBytes, const uint64_t memoryBudgetBytes)
+{
+	const uint64_t numFiles = (dataBytes + memoryBudgetBytes - 1) / memoryBudgetBytes;
+	return size_t(std::clamp<uint64_t>(numFiles, 1, MAX_SHUFFLE_TEMP_FILES));
+}
+
+// how a shuffle of dataBytes splits up to stay within the memory budget
+struct ShuffleLayout
+{
+	size_t NumBuckets;
+	size_t NumBlocks;
+	// below the thread count once MAX_SHUFFLE_TEMP_FILES makes buckets larger than a thread's share of the budget
+	size_t NumDeduplicateThreads;
+	// the most held at once by either phase, above the budget only if a single bucket or block doesn't fit it
+	uint64_t PeakMemoryBytes;
+};
+
+forceinline ShuffleLayout GetShuffleLayout(const uint64_t dataBytes, const uint64_t memoryBudgetBytes, const size_t numThreads)
+{
+	// a bucket being deduplicated takes its size twice, stable_sort sorts through a buffer as large as the bucket
+	constexpr uint64_t DEDUPLICATE_MEMORY_FACTOR = 2;
+	constexpr uint64_t WRITE_BUFFER_BYTES = SHUFFLE_WRITE_BUFFER_ENTRIES * sizeof(PositionEntry);
+
+	ShuffleLayout layout;
+	layout.NumBlocks = GetNumShuffleTempFiles(dataBytes, memoryBudgetBytes);
+
+	// every deduplicating thread buffers its writes to all the blocks, its bucket gets what is left of its share
+	const uint64_t threadBufferBytes = layout.NumBlocks * WRITE_BUFFER_BYTES;
+	const uint64_t bucketBudgetBytes = std::max<uint64_t>(memoryBudgetBytes / numThreads, threadBufferBytes + 1) - threadBufferBytes;
+	// the partition buffers its writes to all the buckets, more of them than fit the budget would break it on their own
+	const size_t maxBuckets = size_t(std::max<uint64_t>(memoryBudgetBytes / WRITE_BUFFER_BYTES, 1));
+	layout.NumBuckets = std::min(GetNumShuffleTempFiles(dataBytes * DEDUPLICATE_MEMORY_FACTOR, bucketBudgetBytes), maxBuckets);
+
+	const uint64_t threadMemoryBytes = (dataBytes + layout.NumBuckets - 1) / layout.NumBuckets * DEDUPLICATE_MEMORY_FACTOR + threadBufferBytes;
+	layout.NumDeduplicateThreads = size_t(std::clamp<uint64_t>(memoryBudgetBytes / threadMemoryBytes, 1, numThreads));
+
+	const uint64_t partitionMemoryBytes = layout.NumBuckets * WRITE_BUFFER_BYTES;
+	const uint64_t blockMemoryBytes = (dataBytes + layout.NumBlocks - 1) / layout.NumBlocks;
+	layout.PeakMemoryBytes = std::max({ partitionMemoryBytes, threadMemoryBytes * layout.NumDeduplicateThreads, blockMemoryBytes });
+	return layout;
+}
+
+// removes the temporary files however the shuffle ends
+struct ScopedTempDirectory
+{
+	std::filesystem::path Path;
+
+	forceinline ScopedTempDirectory(const std::filesystem::path& path) : Path(path) { std::filesystem::create_directories(Path); }
+	forceinline ~ScopedTempDirectory() { std::error_code error; std::filesystem::remove_all(Path, error); }
+
+	ScopedTempDirectory(const ScopedTempDirectory&) = delete;
+	ScopedTempDirectory& operator=(const ScopedTempDirectory&) = delete;
+};
+
+// returns the number of entries partitioned
+inline uint64_t PartitionPositionEntries(const std::vector<std::string>& inputFiles, PositionEntryFileSet& buckets)
+{
+	std::vector<std::vector<PositionEntry>> buffers(buckets.GetNumFiles());
+	uint64_t numEntries = 0;
+
+	// one thread, so every bucket keeps the input order and the first occurrence of a duplicate stays first
+	for (const auto& inputFile : inputFiles)
+	{
+		const PositionEntryReader reader(inputFile);
+		if (reader.GetNumTrailingBytes())
+			std::cout << "  " << inputFile << ": ignoring " << reader.GetNumTrailingBytes() << " trailing bytes of a truncated entry" << std::endl;
+
+		for (const auto& entry : reader)
+			buckets.Append(buffers, HashPositionFeatures(entry) % buckets.GetNumFiles(), entry);
+		numEntries += reader.GetNumEntries();
+	}
+
+	buckets.Flush(buffers);
+	buckets.Close();
+	return numEntries;
+}
+
+// returns the number of unique entries
+inline uint64_t DeduplicateBuckets(const PositionEntryFileSet& buckets, PositionEntryFileSet& blocks, const DataShuffleSettings& settings,
+	const size_t numThreads)
+{
+	std::atomic<size_t> nextBucket = 0;
+	std::atomic<uint64_t> numUniqueEntries = 0;
+	std::exception_ptr exception;
+	std::mutex exceptionMutex;
+
+	const auto worker = [&]()
+		{
+			try
+			{
+				std::vector<std::vector<PositionEntry>> buffers(blocks.GetNumFiles());
+				for (size_t bucketIndex = nextBucket++; bucketIndex < buckets.GetNumFiles(); bucketIndex = nextBucket++)
+				{
+					std::vector<PositionEntry> entries = ReadPositionEntries(buckets.GetPath(bucketIndex));
+					std::filesystem::remove(buckets.GetPath(bucketIndex));
+					const size_t numBucketEntries = DeduplicatePositionEntries(entries);
+
+					// features are unique from here on, so the seeded feature hash is a random block that doesn't depend
+					// on the number of buckets or on which thread got the bucket
+					for (size_t entryIndex = 0; entryIndex < numBucketEntries; entryIndex++)
+					{
+						const uint64_t blockHash = GetShuffleSeed(settings.Seed, HashPositionFeatures(entries[entryIndex]));
+						blocks.Append(buffers, blockHash % blocks.GetNumFiles(), entries[entryIndex]);
+					}
+					numUniqueEntries += numBucketEntries;
+				}
+				blocks.Flush(buffers);
+			}
+			catch (...)
+			{
+				const std::lock_guard<std::mutex> lock(exceptionMutex);
+				if (!exception)
+					exception = std::current_exception();
+			}
+		};
+
+	std::vector<std::thread> threads;
+	for (size_t threadIndex = 0; threadIndex < numThreads; threadIndex++)
+		threads.emplace_back(worker);
+	for (auto& thread : threads)
+		thread.join();
+
+	if (exception)
+		std::rethrow_exception(exception);
+
+	blocks.Close();
+	return numUniqueEntries;
+}
+
+inline void ShuffleBlocksToOutput(const PositionEntryFileSet& blocks, const DataShuffleSettings& settings)
+{
+	std::ofstream output(settings.OutputFile, std::ios::binary);
+	if (!output.is_open())
+		throw std::runtime_error("could not open " + settings.OutputFile + " for writing");
+
+	for (size_t blockIndex = 0; blockIndex < blocks.GetNumFiles(); blockIndex++)
+	{
+		std::vector<PositionEntry> entries = ReadPositionEntries(blocks.GetPath(blockIndex));
+		std::filesystem::remove(blocks.GetPath(blockIndex));
+
+		// threads append to a block in whatever order they get to it, sorting first makes the output depend only on the seed
+		std::sort(entries.begin(), entries.end(), [](const PositionEntry& left, const PositionEntry& right)
+			{
+				return CompareFeatures(left, right) < 0;
+			});
+		// std::shuffle is a Fisher-Yates shuffle
+		Xorshift64 rng(GetShuffleSeed(~settings.Seed, blockIndex));
+		std::shuffle(entries.begin(), entries.end(), rng);
+
+		output.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PositionEntry)));
+		if (output.fail())
+			throw std::runtime_error("failed writing " + settings.OutputFile);
+	}
+}
+
+inline void RunDataShuffle(const DataShuffleSettings& settings)
+{
+	if (settings.InputFiles.empty() || settings.OutputFile.empty())
+		throw std::runtime_error("shuffle needs input files and an output file");
+
+	uint64_t totalBytes = 0;
+	for (const auto& inputFile : settings.InputFiles)
+		totalBytes += std::filesystem::file_size(inputFile);
+
+	const uint64_t memoryBudgetBytes = std::max<uint64_t>(settings.MemoryBudgetMB, 1) * 1024 * 1024;
+	// every thread holds a bucket at once, but only one block is in memory while the output is written
+	const ShuffleLayout layout = GetShuffleLayout(totalBytes, memoryBudgetBytes, settings.NumThreads);
+	const ScopedTempDirectory tempDirectory(settings.TempDirectory.empty() ? settings.OutputFile + ".tmp" : settings.TempDirectory);
+
+	std::cout << "Shuffling " << settings.InputFiles.size() << " files (" << std::fixed << std::setprecision(1)
+		<< double(totalBytes) / (1024.0 * 1024.0) << " MB) into " << settings.OutputFile << std::endl;
+	std::cout << "  Threads: " << settings.NumThreads;
+	if (layout.NumDeduplicateThreads < settings.NumThreads)
+		std::cout << ", " << layout.NumDeduplicateThreads << " deduplicating to stay within the memory budget";
+	std::cout << std::endl;
+	std::cout << "  Buckets: " << layout.NumBuckets << std::endl;
+	std::cout << "  Blocks: " << layout.NumBlocks << std::endl;
+	if (layout.PeakMemoryBytes > memoryBudgetBytes)
+	{
+		std::cout << "Warning: the data doesn't fit a " << settings.MemoryBudgetMB << " MB budget with at most " << MAX_SHUFFLE_TEMP_FILES
+			<< " temporary files, around " << (layout.PeakMemoryBytes + 1024 * 1024 - 1) / (1024 * 1024) << " MB will be used" << std::endl;
+	}
+	std::cout << "  Seed: " << settings.Seed << std::endl;
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const auto printPhase = [&startTime](const std::string& phase)
+		{
+			const double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+			std::cout << phase << " (" << std::fixed << std::setprecision(1) << elapsedSeconds << "s)" << std::endl;
+		};
+
+	PositionEntryFileSet buckets(tempDirectory.Path, "bucket", layout.NumBuckets);
+	const uint64_t numEntries = PartitionPositionEntries(settings.InputFiles, buckets);
+	printPhase("Partitioned " + std::to_string(numEntries) + " entries");
+
+	PositionEntryFileSet blocks(tempDirectory.Path, "block", layout.NumBlocks);
+	const uint64_t numUniqueEntries = DeduplicateBuckets(buckets, blocks, settings, layout.NumDeduplicateThreads);
+	printPhase("Removed " + std::to_string(numEntries - numUniqueEntries) + " duplicates, " + std::to_string(numUniqueEntries) + " unique entries remain");
+
+	ShuffleBlocksToOutput(blocks, settings);
+	printPhase("Written to " + settings.OutputFile + " (" + std::to_string(numUniqueEntries * sizeof(PositionEntry) / (1024 * 1024)) + " MB)");
+}
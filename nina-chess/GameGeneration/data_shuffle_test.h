@@ -0,0 +1,193 @@
+#pragma once
+#include "Chess/move.h"
+#include "Chess/move_type.h"
+#include "Chess/piece_type.h"
+#include "Eval/score.h"
+#include "GameGeneration/data_shuffle.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/position_entry_reader.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// a file with known duplicates goes through a shuffle with a tiny memory budget, so it takes several buckets, blocks and threads
+// every position has to come out once, merged like scripts/shuffle_data.py does it, and the order may only depend on the seed
+inline bool TestDataShuffle()
+{
+	constexpr size_t NUM_UNIQUE_ENTRIES = 20000;
+	constexpr size_t MAX_OCCURRENCES = 4;
+	// coprime with NUM_UNIQUE_ENTRIES, it scatters every round of duplicates over the whole file
+	constexpr size_t SCATTER_STEP = 7919;
+	constexpr size_t NUM_THREADS = 2;
+	constexpr size_t MEMORY_BUDGET_MB = 4;
+	constexpr uint64_t SEED = 42;
+	const std::string inputFile = "test_shuffle_input.bin";
+	const std::string outputFiles[] = { "test_shuffle_output.bin", "test_shuffle_output_same_seed.bin", "test_shuffle_output_other_seed.bin" };
+
+	const auto getNumOccurrences = [](const size_t uniqueIndex) { return uniqueIndex % MAX_OCCURRENCES + 1; };
+	// pairs of occurrences sum to odd scores and results, so averages land on .5 and the rounding is tested
+	const auto getOccurrence = [](const size_t uniqueIndex, const size_t occurrence)
+		{
+			PositionEntry entry{};
+			entry.Features[1] = uniqueIndex + 1;
+			entry.SearchScore = Score(int32_t(uniqueIndex % 200) - 100 + int32_t(occurrence));
+			entry.BestMove = Move(uint32_t(occurrence), uint32_t(uniqueIndex % 64), PAWN, MoveType::NORMAL);
+			entry.Result = uint32_t((uniqueIndex + occurrence) % 3);
+			entry.SideToMove = uint32_t((uniqueIndex + occurrence) % 2);
+			return entry;
+		};
+	// python's round, written out instead of going through the same std::nearbyint as the shuffle
+	const auto roundHalfToEven = [](const int64_t sum, const int64_t count)
+		{
+			int64_t quotient = sum / count;
+			int64_t remainder = sum % count;
+			if (remainder < 0)
+			{
+				quotient--;
+				remainder += count;
+			}
+			if (2 * remainder > count || (2 * remainder == count && quotient % 2 != 0))
+				quotient++;
+			return quotient;
+		};
+
+	size_t numInputEntries = 0;
+	{
+		std::ofstream input(inputFile, std::ios::binary);
+		for (size_t occurrence = 0; occurrence < MAX_OCCURRENCES; occurrence++)
+		{
+			for (size_t entryIndex = 0; entryIndex < NUM_UNIQUE_ENTRIES; entryIndex++)
+			{
+				const size_t uniqueIndex = entryIndex * SCATTER_STEP % NUM_UNIQUE_ENTRIES;
+				if (occurrence >= getNumOccurrences(uniqueIndex))
+					continue;
+
+				const PositionEntry entry = getOccurrence(uniqueIndex, occurrence);
+				input.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+				numInputEntries++;
+			}
+		}
+	}
+
+	std::cout << "Running data shuffle test: " << numInputEntries << " entries, " << NUM_UNIQUE_ENTRIES << " unique\n";
+
+	const auto removeFiles = [&]()
+		{
+			std::remove(inputFile.c_str());
+			for (const auto& outputFile : outputFiles)
+				std::remove(outputFile.c_str());
+		};
+
+	constexpr uint64_t MB = 1024 * 1024;
+	const ShuffleLayout layout = GetShuffleLayout(numInputEntries * sizeof(PositionEntry), MEMORY_BUDGET_MB * MB, NUM_THREADS);
+	if (layout.NumBuckets < 2 || layout.NumBlocks < 2 || layout.NumDeduplicateThreads != NUM_THREADS || layout.PeakMemoryBytes > MEMORY_BUDGET_MB * MB)
+	{
+		std::cout << "Data shuffle test failed: the input takes " << layout.NumBuckets << " buckets, " << layout.NumBlocks << " blocks and "
+			<< layout.NumDeduplicateThreads << " threads" << std::endl;
+		removeFiles();
+		return false;
+	}
+
+	// past MAX_SHUFFLE_TEMP_FILES buckets are larger than planned, fewer threads deduplicate so they still fit,
+	// only once a single block outgrows the budget it can't be kept
+	const ShuffleLayout cappedLayout = GetShuffleLayout(200 * 1024 * MB, 1024 * MB, 16);
+	const ShuffleLayout overBudgetLayout = GetShuffleLayout(1024 * 1024 * MB, 1024 * MB, 16);
+	if (cappedLayout.NumBuckets != MAX_SHUFFLE_TEMP_FILES || cappedLayout.NumDeduplicateThreads >= 16 || cappedLayout.PeakMemoryBytes > 1024 * MB ||
+		overBudgetLayout.PeakMemoryBytes <= 1024 * MB)
+	{
+		std::cout << "Data shuffle test failed: the temporary file limit doesn't keep to the memory budget" << std::endl;
+		removeFiles();
+		return false;
+	}
+
+	DataShuffleSettings settings;
+	settings.InputFiles = { inputFile };
+	settings.NumThreads = NUM_THREADS;
+	settings.MemoryBudgetMB = MEMORY_BUDGET_MB;
+
+	std::vector<PositionEntry> outputEntries;
+	std::vector<uint8_t> outputs[3];
+	try
+	{
+		const uint64_t seeds[] = { SEED, SEED, SEED + 1 };
+		for (size_t runIndex = 0; runIndex < 3; runIndex++)
+		{
+			settings.OutputFile = outputFiles[runIndex];
+			settings.Seed = seeds[runIndex];
+			RunDataShuffle(settings);
+
+			const PositionEntryReader reader(outputFiles[runIndex]);
+			const auto* bytes = reinterpret_cast<const uint8_t*>(reader.begin());
+			outputs[runIndex].assign(bytes, bytes + reader.GetNumEntries() * sizeof(PositionEntry));
+			if (runIndex == 0)
+				outputEntries.assign(reader.begin(), reader.end());
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << "Data shuffle failed: " << ex.what() << std::endl;
+		removeFiles();
+		return false;
+	}
+	removeFiles();
+
+	if (outputEntries.size() != NUM_UNIQUE_ENTRIES)
+	{
+		std::cout << "Data shuffle test failed: " << outputEntries.size() << " entries out, expected " << NUM_UNIQUE_ENTRIES << std::endl;
+		return false;
+	}
+
+	std::vector<bool> isSeen(NUM_UNIQUE_ENTRIES);
+	for (const auto& entry : outputEntries)
+	{
+		const size_t uniqueIndex = size_t(entry.Features[1] - 1);
+		if (uniqueIndex >= NUM_UNIQUE_ENTRIES || isSeen[uniqueIndex])
+		{
+			std::cout << "Data shuffle test failed: position " << uniqueIndex << " is unknown or came out twice" << std::endl;
+			return false;
+		}
+		isSeen[uniqueIndex] = true;
+
+		const size_t numOccurrences = getNumOccurrences(uniqueIndex);
+		int64_t scoreSum = 0;
+		int64_t resultSum = 0;
+		for (size_t occurrence = 0; occurrence < numOccurrences; occurrence++)
+		{
+			const PositionEntry duplicate = getOccurrence(uniqueIndex, occurrence);
+			scoreSum += int32_t(duplicate.SearchScore);
+			resultSum += duplicate.Result;
+		}
+
+		PositionEntry expectedEntry = getOccurrence(uniqueIndex, 0);
+		expectedEntry.SearchScore = Score(int32_t(roundHalfToEven(scoreSum, int64_t(numOccurrences))));
+		expectedEntry.Result = uint32_t(roundHalfToEven(resultSum, int64_t(numOccurrences)));
+		if (std::memcmp(&entry, &expectedEntry, sizeof(PositionEntry)) != 0)
+		{
+			std::cout << "Data shuffle test failed: position " << uniqueIndex << " with " << numOccurrences << " occurrences has score "
+				<< int32_t(entry.SearchScore) << " and result " << entry.Result << ", expected " << int32_t(expectedEntry.SearchScore)
+				<< " and " << expectedEntry.Result << ", or lost its first best move and side to move" << std::endl;
+			return false;
+		}
+	}
+
+	if (outputs[0] != outputs[1])
+	{
+		std::cout << "Data shuffle test failed: the same seed gave a different order" << std::endl;
+		return false;
+	}
+
+	if (outputs[0] == outputs[2])
+	{
+		std::cout << "Data shuffle test failed: another seed gave the same order" << std::endl;
+		return false;
+	}
+
+	std::cout << "Data shuffle test passed: " << numInputEntries - NUM_UNIQUE_ENTRIES << " duplicates removed" << std::endl;
+	return true;
+}
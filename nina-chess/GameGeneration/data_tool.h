@@ -0,0 +1,225 @@
+#pragma once
+#include "Chess/color.h"
+#include "Core/Engine/utils.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
+#include "Eval/score.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/position_entry_reader.h"
+#include "Hardware/intrinsics.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// offline checks and statistics over game generation output, run by the datatool target
+// every file is memory mapped and split into one contiguous shard per thread
+
+inline constexpr int32_t SCORE_HISTOGRAM_BUCKET_WIDTH = 50;
+inline constexpr size_t NUM_SCORE_HISTOGRAM_BUCKETS = (int32_t(Score::WIN) - int32_t(Score::LOSS)) / SCORE_HISTOGRAM_BUCKET_WIDTH;
+inline constexpr size_t NUM_RESULT_BUCKETS = 4;
+// only the first few invalid entries are kept, a broken file would otherwise print millions of them
+inline constexpr size_t MAX_REPORTED_INVALID_ENTRIES = 8;
+
+struct InvalidEntry
+{
+	size_t EntryIndex;
+	const char* Reason;
+};
+
+struct DataStatistics
+{
+	size_t NumEntries = 0;
+	size_t NumInvalidEntries = 0;
+	size_t ResultCounts[NUM_RESULT_BUCKETS] = {};
+	size_t SideToMoveCounts[COLOR_NONE] = {};
+	size_t ScoreHistogram[NUM_SCORE_HISTOGRAM_BUCKETS] = {};
+	std::vector<InvalidEntry> InvalidEntries;
+
+	forceinline void Merge(const DataStatistics& other);
+};
+
+forceinline void DataStatistics::Merge(const DataStatistics& other)
+{
+	NumEntries += other.NumEntries;
+	NumInvalidEntries += other.NumInvalidEntries;
+	for (size_t resultIndex = 0; resultIndex < NUM_RESULT_BUCKETS; resultIndex++)
+		ResultCounts[resultIndex] += other.ResultCounts[resultIndex];
+	for (size_t colorIndex = 0; colorIndex < COLOR_NONE; colorIndex++)
+		SideToMoveCounts[colorIndex] += other.SideToMoveCounts[colorIndex];
+	for (size_t bucketIndex = 0; bucketIndex < NUM_SCORE_HISTOGRAM_BUCKETS; bucketIndex++)
+		ScoreHistogram[bucketIndex] += other.ScoreHistogram[bucketIndex];
+	for (const auto& invalidEntry : other.InvalidEntries)
+		if (InvalidEntries.size() < MAX_REPORTED_INVALID_ENTRIES)
+			InvalidEntries.push_back(invalidEntry);
+}
+
+// returns why the entry can't have been written by the game generator, nullptr if it could have
+inline const char* ValidatePositionEntry(const PositionEntry& entry)
+{
+	constexpr Bitboard BACK_RANKS = 0xFF000000000000FFULL;
+	const uint64_t* features = entry.Features;
+
+	if (entry.SideToMove != WHITE && entry.SideToMove != BLACK)
+		return "side to move";
+	if (entry.Result > uint32_t(GameResult::WHITE_WIN))
+		return "result";
+	if (entry.SearchScore < Score::LOSS || entry.SearchScore > Score::WIN)
+		return "search score";
+
+	Bitboard whitePieces = 0;
+	Bitboard blackPieces = 0;
+	for (size_t pieceIndex = 0; pieceIndex < ChessBitboardFeatureIterator::NUM_SIDE_FEATURES; pieceIndex++)
+	{
+		const Bitboard whitePiece = features[ChessBitboardFeatureIterator::WHITE_PIECES_START + pieceIndex];
+		const Bitboard blackPiece = features[ChessBitboardFeatureIterator::BLACK_PIECES_START + pieceIndex];
+		if ((whitePieces & whitePiece) || (blackPieces & blackPiece))
+			return "two pieces on one square";
+		whitePieces |= whitePiece;
+		blackPieces |= blackPiece;
+	}
+	if (whitePieces & blackPieces)
+		return "two pieces on one square";
+
+	if (Popcnt(features[ChessBitboardFeatureIterator::WHITE_PIECES_START + KING]) != 1 ||
+		Popcnt(features[ChessBitboardFeatureIterator::BLACK_PIECES_START + KING]) != 1)
+		return "king count";
+	if ((features[ChessBitboardFeatureIterator::WHITE_PIECES_START + PAWN] | features[ChessBitboardFeatureIterator::BLACK_PIECES_START + PAWN]) & BACK_RANKS)
+		return "pawn on a back rank";
+	if (Popcnt(features[ChessBitboardFeatureIterator::EN_PASSANT_INDEX]) > 1)
+		return "en passant square";
+
+	return nullptr;
+}
+
+inline DataStatistics CollectDataStatistics(const std::span<const PositionEntry> entries, const size_t firstEntryIndex)
+{
+	DataStatistics statistics;
+	statistics.NumEntries = entries.size();
+
+	for (size_t entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+	{
+		const PositionEntry& entry = entries[entryIndex];
+		if (const char* reason = ValidatePositionEntry(entry))
+		{
+			statistics.NumInvalidEntries++;
+			if (statistics.InvalidEntries.size() < MAX_REPORTED_INVALID_ENTRIES)
+				statistics.InvalidEntries.push_back({ firstEntryIndex + entryIndex, reason });
+			continue;
+		}
+
+		statistics.ResultCounts[entry.Result]++;
+		statistics.SideToMoveCounts[entry.SideToMove]++;
+
+		const size_t bucket = size_t(int32_t(entry.SearchScore) - int32_t(Score::LOSS)) / SCORE_HISTOGRAM_BUCKET_WIDTH;
+		statistics.ScoreHistogram[bucket < NUM_SCORE_HISTOGRAM_BUCKETS ? bucket : NUM_SCORE_HISTOGRAM_BUCKETS - 1]++;
+	}
+
+	return statistics;
+}
+
+inline DataStatistics CollectDataStatistics(const PositionEntryReader& reader, const size_t numThreads)
+{
+	std::vector<DataStatistics> shardStatistics(numThreads);
+	std::vector<std::thread> threads;
+	size_t firstEntryIndex = 0;
+	for (size_t shardIndex = 0; shardIndex < numThreads; shardIndex++)
+	{
+		const auto shard = reader.GetShard(shardIndex, numThreads);
+		threads.emplace_back([&shardStatistics, shard, shardIndex, firstEntryIndex]()
+			{
+				shardStatistics[shardIndex] = CollectDataStatistics(shard, firstEntryIndex);
+			});
+		firstEntryIndex += shard.size();
+	}
+
+	DataStatistics statistics;
+	for (size_t shardIndex = 0; shardIndex < numThreads; shardIndex++)
+	{
+		threads[shardIndex].join();
+		statistics.Merge(shardStatistics[shardIndex]);
+	}
+	return statistics;
+}
+
+inline void PrintDataStatistics(const DataStatistics& statistics)
+{
+	const auto percent = [&statistics](const size_t count)
+		{
+			return statistics.NumEntries ? 100.0 * double(count) / double(statistics.NumEntries) : 0.0;
+		};
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "results:\n"
+		<< "  white wins " << statistics.ResultCounts[uint32_t(GameResult::WHITE_WIN)] << " (" << percent(statistics.ResultCounts[uint32_t(GameResult::WHITE_WIN)]) << "%)\n"
+		<< "  draws      " << statistics.ResultCounts[uint32_t(GameResult::DRAW)] << " (" << percent(statistics.ResultCounts[uint32_t(GameResult::DRAW)]) << "%)\n"
+		<< "  black wins " << statistics.ResultCounts[uint32_t(GameResult::BLACK_WIN)] << " (" << percent(statistics.ResultCounts[uint32_t(GameResult::BLACK_WIN)]) << "%)\n";
+	std::cout << "side to move:\n"
+		<< "  white " << statistics.SideToMoveCounts[WHITE] << " (" << percent(statistics.SideToMoveCounts[WHITE]) << "%)\n"
+		<< "  black " << statistics.SideToMoveCounts[BLACK] << " (" << percent(statistics.SideToMoveCounts[BLACK]) << "%)\n";
+	std::cout << "search scores (side to move relative):\n";
+	for (size_t bucketIndex = 0; bucketIndex < NUM_SCORE_HISTOGRAM_BUCKETS; bucketIndex++)
+	{
+		const int32_t bucketStart = int32_t(Score::LOSS) + int32_t(bucketIndex) * SCORE_HISTOGRAM_BUCKET_WIDTH;
+		std::cout << "  [" << std::setw(5) << bucketStart << ", " << std::setw(5) << bucketStart + SCORE_HISTOGRAM_BUCKET_WIDTH << ") "
+			<< std::setw(12) << statistics.ScoreHistogram[bucketIndex] << " (" << percent(statistics.ScoreHistogram[bucketIndex]) << "%)\n";
+	}
+	std::cout << std::defaultfloat;
+}
+
+// command is count, validate or stats, returns the process exit code
+inline int RunDataTool(const std::string& command, const std::vector<std::string>& files, const size_t numThreads)
+{
+	if (command != "count" && command != "validate" && command != "stats")
+	{
+		std::cerr << "unknown command " << command << ", expected count, validate or stats" << std::endl;
+		return 1;
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	DataStatistics totalStatistics;
+	size_t totalBytes = 0;
+	bool hasTruncatedFile = false;
+
+	for (const auto& file : files)
+	{
+		const PositionEntryReader reader(file);
+		totalBytes += reader.GetNumEntries() * sizeof(PositionEntry) + reader.GetNumTrailingBytes();
+		std::cout << file << ": " << reader.GetNumEntries() << " entries";
+		if (reader.GetNumTrailingBytes())
+		{
+			hasTruncatedFile = true;
+			std::cout << ", " << reader.GetNumTrailingBytes() << " trailing bytes of a truncated entry";
+		}
+
+		if (command == "count")
+		{
+			std::cout << "\n";
+			totalStatistics.NumEntries += reader.GetNumEntries();
+			continue;
+		}
+
+		const DataStatistics statistics = CollectDataStatistics(reader, numThreads);
+		std::cout << ", " << statistics.NumInvalidEntries << " invalid\n";
+		for (const auto& invalidEntry : statistics.InvalidEntries)
+			std::cout << "  entry " << invalidEntry.EntryIndex << ": " << invalidEntry.Reason << "\n";
+		totalStatistics.Merge(statistics);
+	}
+
+	const double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	std::cout << "total: " << totalStatistics.NumEntries << " entries";
+	if (command != "count")
+		std::cout << ", " << totalStatistics.NumInvalidEntries << " invalid";
+	std::cout << ", " << std::fixed << std::setprecision(1) << double(totalBytes) / (1024.0 * 1024.0) / (elapsedSeconds > 0 ? elapsedSeconds : 1.0)
+		<< " MB/s" << std::defaultfloat << std::endl;
+
+	if (command == "stats")
+		PrintDataStatistics(totalStatistics);
+
+	if (command == "validate")
+		return (totalStatistics.NumInvalidEntries || hasTruncatedFile) ? 1 : 0;
+	return 0;
+}
@@ -7,7 +7,12 @@
 #include "Eval/chess_bitboard_feature_iterator.h"
 #include "Eval/evaluator.h"
 #include "Eval/score.h"
+#include "GameGeneration/async_entry_writer.h"
 #include "GameGeneration/book.h"
+#include "GameGeneration/generation_checkpoint.h"
+#include "GameGeneration/packed_data.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/shard_set.h"
 #include "MoveGen/move_list.h"
 #include "Search/SearchContext/SearchCancellationPolicies/search_time_cancellation_policy.h"
 #include "Search/SearchContext/shared_search_context.h"
@@ -15,12 +20,14 @@
 #include "Search/search.h"
 #include "Search/search_constraints.h"
 #include "Search/transposition_table.h"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <exception>
-#include <fstream>
+#include <filesystem>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -32,23 +39,6 @@
 #include <thread>
 #include <vector>
 
-enum class GameResult : uint32_t
-{
-	BLACK_WIN = 0,
-	DRAW = 1,
-	WHITE_WIN = 2,
-	UNKNOWN = 255
-};
-
-struct PositionEntry
-{
-	uint64_t Features[ChessBitboardFeatureIterator::NumBitboardFeatures()];
-	Score SearchScore;
-	Move BestMove;
-	uint32_t Result;
-	uint32_t SideToMove;
-};
-
 using Game = std::vector<PositionEntry>;
 
 struct GameGenerationSettings
@@ -65,6 +55,24 @@ struct GameGenerationSettings
 	int MaxGameLength = 200;
 	bool ScoreBySearchEval = true;
 	std::string OutputFile = "data.bin";
+	// games go to OutputFile in the packed_data.h format instead of as raw PositionEntry records
+	bool PackedOutput = false;
+	// every thread writes its own OutputFile.NNN shard, listed in OutputFile.shards, instead of all sharing OutputFile
+	bool ShardedOutput = false;
+	// continue the run recorded in OutputFile's manifest instead of starting over
+	bool Resume = false;
+	int CheckpointIntervalSeconds = 300;
+	// 0 picks one from the clock, a resumed run keeps the seed of its manifest
+	uint64_t Seed = 0;
+	// a game is won once the searches of WinAdjudicationPlies plies in a row, so both sides, saw the same side ahead
+	// by at least WinAdjudicationScore, 0 plies turns it off
+	int WinAdjudicationPlies = 0;
+	int WinAdjudicationScore = 900;
+	// a game is drawn once DrawAdjudicationPlies plies in a row from ply DrawAdjudicationStartPly on scored
+	// within DrawAdjudicationScore of a draw, 0 plies turns it off
+	int DrawAdjudicationPlies = 0;
+	int DrawAdjudicationScore = 10;
+	int DrawAdjudicationStartPly = 60;
 	std::string BookFile = "D:\\source\\nina-chess\\book.bin";
 	int BookPly = 0; // 0 = random from available plies
 };
@@ -76,37 +84,6 @@ struct MoveDecision
 	bool IsRandom;
 };
 
-forceinline PositionEntry PackPosition(const Position& position, const MoveListMiscellaneous& moveListMisc,
-	const Score score, const Move& bestMove)
-{
-	PositionEntry entry{};
-
-	std::memcpy(
-		&entry.Features[ChessBitboardFeatureIterator::WHITE_PIECES_START],
-		&position.WhitePieces.Pawns,
-		ChessBitboardFeatureIterator::NUM_SIDE_FEATURES * sizeof(uint64_t));
-
-	std::memcpy(
-		&entry.Features[ChessBitboardFeatureIterator::BLACK_PIECES_START],
-		&position.BlackPieces.Pawns,
-		ChessBitboardFeatureIterator::NUM_SIDE_FEATURES * sizeof(uint64_t));
-
-	entry.Features[ChessBitboardFeatureIterator::EN_PASSANT_INDEX] = position.EnPassantSquare;
-	entry.Features[ChessBitboardFeatureIterator::CASTLING_INDEX] = position.CastlingPermissions.CurrentCastlingPermissions;
-
-	std::memcpy(
-		&entry.Features[ChessBitboardFeatureIterator::MOVELIST_MISC_START],
-		&moveListMisc.PieceMoves[0],
-		ChessBitboardFeatureIterator::NUM_MOVELIST_MISC_FEATURES * sizeof(uint64_t));
-
-	entry.SearchScore = score;
-	entry.BestMove = bestMove;
-	entry.SideToMove = static_cast<uint32_t>(position.SideToMove);
-	entry.Result = static_cast<uint32_t>(GameResult::UNKNOWN);
-
-	return entry;
-}
-
 forceinline SearchConstraints BuildSearchConstraints(const GameGenerationSettings& settings)
 {
 	SearchConstraints constraints;
@@ -131,6 +108,52 @@ forceinline GameResult IsGameOver(const Position& position, const PositionStack&
 	return GameResult::UNKNOWN;
 }
 
+// ends games whose outcome the searches already agree on, instead of playing them out to mate or MaxGameLength
+// random moves can throw away whatever the search saw, so they start the count over
+class GameAdjudicator
+{
+public:
+	forceinline GameAdjudicator(const GameGenerationSettings& settings) : m_Settings(settings) {}
+
+	// score is the search score of the position at ply, relative to its side to move
+	forceinline GameResult Update(const Score score, const Color sideToMove, const int ply, const bool isRandomMove);
+
+private:
+	const GameGenerationSettings& m_Settings;
+	int m_NumWinningPlies = 0;
+	Color m_WinningSide = WHITE;
+	int m_NumDrawnPlies = 0;
+};
+
+forceinline GameResult GameAdjudicator::Update(const Score score, const Color sideToMove, const int ply, const bool isRandomMove)
+{
+	if (isRandomMove)
+	{
+		m_NumWinningPlies = 0;
+		m_NumDrawnPlies = 0;
+		return GameResult::UNKNOWN;
+	}
+
+	const int32_t whiteScore = static_cast<int32_t>(sideToMove == WHITE ? score : -score);
+	if (std::abs(whiteScore) >= m_Settings.WinAdjudicationScore)
+	{
+		const Color winningSide = whiteScore > 0 ? WHITE : BLACK;
+		m_NumWinningPlies = (m_NumWinningPlies && winningSide == m_WinningSide) ? m_NumWinningPlies + 1 : 1;
+		m_WinningSide = winningSide;
+	}
+	else
+		m_NumWinningPlies = 0;
+
+	const bool isDrawnScore = ply >= m_Settings.DrawAdjudicationStartPly && std::abs(whiteScore) <= m_Settings.DrawAdjudicationScore;
+	m_NumDrawnPlies = isDrawnScore ? m_NumDrawnPlies + 1 : 0;
+
+	if (m_Settings.WinAdjudicationPlies > 0 && m_NumWinningPlies >= m_Settings.WinAdjudicationPlies)
+		return m_WinningSide == WHITE ? GameResult::WHITE_WIN : GameResult::BLACK_WIN;
+	if (m_Settings.DrawAdjudicationPlies > 0 && m_NumDrawnPlies >= m_Settings.DrawAdjudicationPlies)
+		return GameResult::DRAW;
+	return GameResult::UNKNOWN;
+}
+
 forceinline Move GetRandomMoveIfNeeded(const MoveList& moveList, Xorshift64& rng,
 	const GameGenerationSettings& settings, const int ply, const int randomMovesAfterOpening,
 	const bool lastMoveWasRandom, const float currentRandomChance)
@@ -159,6 +182,7 @@ forceinline MoveDecision DecideOnMove(PositionStack& positionStack, Evaluator& e
 	const SearchConstraints constraints = BuildSearchConstraints(settings);
 	const TimePoint searchStart = std::chrono::high_resolution_clock::now();
 	SharedSearchContext searchContext(constraints, searchStart, &transpositionTable);
+	transpositionTable.NewSearch();
 	const auto results = StartSearch<false>(positionStack, evaluator, searchContext);
 
 	if (results.empty())
@@ -231,6 +255,7 @@ inline Game PlayOneGame(const GameGenerationSettings& settings, const uint64_t s
 	int randomMovesAfterOpening = 0;
 	float currentRandomChance = settings.RandomMoveChance;
 	bool lastMoveWasRandom = false;
+	GameAdjudicator adjudicator(settings);
 
 	while (ply < settings.MaxGameLength)
 	{
@@ -255,6 +280,13 @@ inline Game PlayOneGame(const GameGenerationSettings& settings, const uint64_t s
 			decision.SearchScore, decision.ChosenMove);
 		game.push_back(entry);
 
+		const GameResult adjudication = adjudicator.Update(decision.SearchScore, currentPosition.SideToMove, ply, decision.IsRandom);
+		if (adjudication != GameResult::UNKNOWN)
+		{
+			result = adjudication;
+			break;
+		}
+
 		MakeMoveAndUpdate(positionStack, evaluator, decision.ChosenMove, currentPosition.SideToMove);
 
 		lastMoveWasRandom = decision.IsRandom;
@@ -273,12 +305,28 @@ inline Game PlayOneGame(const GameGenerationSettings& settings, const uint64_t s
 struct SharedGameGenState
 {
 	std::mutex Mutex;
-	std::ofstream OutputFile;
+	// one per shard in a sharded run, a single shared one otherwise
+	std::vector<AsyncEntryWriter*> Writers;
+	// games are handed out one at a time, a thread that got short games just takes more of them
+	std::atomic<int> NextGame{ 0 };
+	// games the resumed run already has on disk, skipped when handing out games
+	GameIndexRanges ResumedGames;
+	uint64_t Seed;
 	std::atomic<int> GamesCompleted{ 0 };
 	std::atomic<int> TotalPositions{ 0 };
+	// summed over all workers, only the time they couldn't play because the writer was behind
+	std::atomic<int64_t> IoBlockedNanoseconds{ 0 };
 	int TotalGames;
 	std::exception_ptr Exception;
 	TimePoint StartTime;
+	// when every worker ran out of games, the idle tail is how long each one waited for the slowest
+	std::vector<TimePoint> WorkerFinishTimes;
+
+	forceinline AsyncEntryWriter& GetWriter(const int threadId) const { return *Writers[size_t(threadId) % Writers.size()]; }
+	forceinline bool HasWriterFailed() const
+	{
+		return std::any_of(Writers.begin(), Writers.end(), [](const AsyncEntryWriter* writer) { return writer->HasFailed(); });
+	}
 };
 
 inline void PrintProgress(const SharedGameGenState& shared, const int completed)
@@ -304,65 +352,60 @@ inline void PrintProgress(const SharedGameGenState& shared, const int completed)
 		<< completed << "/" << shared.TotalGames << " | "
 		<< std::fixed << std::setprecision(1) << gamesPerSecond << " g/s | "
 		<< std::setprecision(0) << positionsPerSecond << " pos/s | "
+		<< std::setprecision(1) << "io wait " << double(shared.IoBlockedNanoseconds.load()) * 1e-9 << "s | "
 		<< "ETA " << etaMinutes << "m" << std::setw(2) << std::setfill('0') << etaRemainderSeconds << "s"
 		<< std::setfill(' ') << "    " << std::flush;
 }
 
 inline constexpr int PROGRESS_UPDATE_INTERVAL = 10;
-inline constexpr size_t WRITE_BUFFER_CAPACITY = 4096 * 1024;
+// writes overlap with playing games, so a buffer only has to be large enough for the writer to keep up
+inline constexpr size_t WRITE_BUFFER_CAPACITY = 64 * 1024;
 
 forceinline bool ShouldPrintProgress(const int completed, const int totalGames)
 {
 	return completed % PROGRESS_UPDATE_INTERVAL == 0 || completed == totalGames;
 }
 
-forceinline bool ShouldFlushBuffer(const std::vector<PositionEntry>& buffer)
+forceinline int TakeNextGame(SharedGameGenState& shared)
 {
-	return buffer.size() >= WRITE_BUFFER_CAPACITY;
-}
-
-inline void FlushBuffer(std::vector<PositionEntry>& buffer, SharedGameGenState& shared)
-{
-	const std::lock_guard<std::mutex> lock(shared.Mutex);
-	shared.OutputFile.write(reinterpret_cast<const char*>(buffer.data()),
-		static_cast<std::streamsize>(buffer.size() * sizeof(PositionEntry)));
-	buffer.clear();
+	int gameIndex = shared.NextGame++;
+	for (int rangeEnd = shared.ResumedGames.GetEndOfRange(gameIndex); rangeEnd != gameIndex; rangeEnd = shared.ResumedGames.GetEndOfRange(gameIndex))
+	{
+		// jump over the rest of the completed range, unless another thread already moved past it
+		int expected = gameIndex + 1;
+		shared.NextGame.compare_exchange_strong(expected, rangeEnd);
+		gameIndex = shared.NextGame++;
+	}
+	return gameIndex;
 }
 
-inline void GameGenThreadWorker(const GameGenerationSettings& settings, const int threadId, const int gamesForThread,
+inline void GameGenThreadWorker(const GameGenerationSettings& settings, const int threadId,
 	SharedGameGenState& sharedGameState, const Book* book)
 {
 	try
 	{
-		std::vector<PositionEntry> buffer;
-		buffer.reserve(WRITE_BUFFER_CAPACITY);
+		DoubleEntryBuffer buffer(sharedGameState.GetWriter(threadId), WRITE_BUFFER_CAPACITY, sharedGameState.IoBlockedNanoseconds);
 
 		PositionStack positionStack;
 		Evaluator evaluator;
 		TranspositionTable transpositionTable(16);
 
-		for (int gameIndex = 0; gameIndex < gamesForThread; gameIndex++)
+		for (int gameIndex = TakeNextGame(sharedGameState); gameIndex < sharedGameState.TotalGames; gameIndex = TakeNextGame(sharedGameState))
 		{
-			if (sharedGameState.Exception)
-				return;
-
-			uint64_t seed = static_cast<uint64_t>(threadId) * 1000000ULL + static_cast<uint64_t>(gameIndex);
-			seed ^= std::chrono::high_resolution_clock::now().time_since_epoch().count();
+			if (sharedGameState.Exception || sharedGameState.HasWriterFailed())
+				break;
 
+			const uint64_t seed = GetGameSeed(sharedGameState.Seed, gameIndex);
 			const Game game = PlayOneGame(settings, seed, positionStack, evaluator, transpositionTable, book);
-			buffer.insert(buffer.end(), game.begin(), game.end());
+			buffer.Append(game, gameIndex);
 
 			sharedGameState.TotalPositions.fetch_add(static_cast<int>(game.size()));
 			const int completed = sharedGameState.GamesCompleted.fetch_add(1) + 1;
 			if (ShouldPrintProgress(completed, sharedGameState.TotalGames))
 				PrintProgress(sharedGameState, completed);
-
-			if (ShouldFlushBuffer(buffer))
-				FlushBuffer(buffer, sharedGameState);
 		}
 
-		if (!buffer.empty())
-			FlushBuffer(buffer, sharedGameState);
+		buffer.Flush();
 	}
 	catch (...)
 	{
@@ -370,6 +413,8 @@ inline void GameGenThreadWorker(const GameGenerationSettings& settings, const in
 		if (!sharedGameState.Exception)
 			sharedGameState.Exception = std::current_exception();
 	}
+
+	sharedGameState.WorkerFinishTimes[threadId] = std::chrono::high_resolution_clock::now();
 }
 
 inline void RunGameGeneration(const GameGenerationSettings& settings)
@@ -386,7 +431,15 @@ inline void RunGameGeneration(const GameGenerationSettings& settings)
 	std::cout << "  Reply random with random: " << (settings.ReplyRandomWithRandom ? "yes" : "no") << std::endl;
 	std::cout << "  Max game length: " << settings.MaxGameLength << std::endl;
 	std::cout << "  Score by eval: " << (settings.ScoreBySearchEval ? "yes" : "no") << std::endl;
-	std::cout << "  Output: " << settings.OutputFile << std::endl;
+	if (settings.WinAdjudicationPlies > 0)
+		std::cout << "  Win adjudication: " << settings.WinAdjudicationPlies << " plies at |score| >= " << settings.WinAdjudicationScore << std::endl;
+	if (settings.DrawAdjudicationPlies > 0)
+	{
+		std::cout << "  Draw adjudication: " << settings.DrawAdjudicationPlies << " plies at |score| <= " << settings.DrawAdjudicationScore
+			<< " from ply " << settings.DrawAdjudicationStartPly << std::endl;
+	}
+	std::cout << "  Output: " << settings.OutputFile << (settings.PackedOutput ? " (packed)" : "")
+		<< (settings.ShardedOutput ? ", a shard per thread" : "") << std::endl;
 	std::cout << "  Entry size: " << sizeof(PositionEntry) << " bytes" << std::endl;
 	if (!settings.BookFile.empty())
 	{
@@ -399,33 +452,97 @@ inline void RunGameGeneration(const GameGenerationSettings& settings)
 	if (!settings.BookFile.empty())
 		book = std::make_unique<Book>(settings.BookFile);
 
+	// a sharded run has a file, a writer and a checkpoint per thread, the shards only share the seed
+	const size_t numOutputs = settings.ShardedOutput ? size_t(settings.NumThreads) : 1;
+	std::vector<std::string> outputFiles;
+	for (size_t outputIndex = 0; outputIndex < numOutputs; outputIndex++)
+		outputFiles.push_back(settings.ShardedOutput ? ShardSetManifest::GetShardFile(settings.OutputFile, outputIndex) : settings.OutputFile);
+
+	std::vector<GenerationCheckpoint> checkpoints(numOutputs);
+	GameIndexRanges resumedGames;
+	if (settings.Resume)
+	{
+		if (settings.ShardedOutput && ShardSetManifest::Load(ShardSetManifest::GetManifestFile(settings.OutputFile)).Shards.size() != numOutputs)
+			throw std::runtime_error(settings.OutputFile + " was started with a different number of threads, resume it with the same number");
+
+		for (size_t outputIndex = 0; outputIndex < numOutputs; outputIndex++)
+		{
+			checkpoints[outputIndex] = GenerationCheckpoint::Load(outputFiles[outputIndex]);
+			if (checkpoints[outputIndex].IsPackedOutput != settings.PackedOutput)
+				throw std::runtime_error(outputFiles[outputIndex] + " was started with a different --packed setting");
+			if (checkpoints[outputIndex].Seed != checkpoints[0].Seed)
+				throw std::runtime_error(outputFiles[outputIndex] + " belongs to a different run");
+			resumedGames.Merge(checkpoints[outputIndex].CompletedGames);
+		}
+		std::cout << "  Resuming: " << resumedGames.GetNumGames() << " games done" << std::endl;
+	}
+	else
+	{
+		const uint64_t seed = settings.Seed ? settings.Seed : std::chrono::high_resolution_clock::now().time_since_epoch().count();
+		for (auto& checkpoint : checkpoints)
+		{
+			checkpoint.Seed = seed;
+			checkpoint.IsPackedOutput = settings.PackedOutput;
+		}
+	}
+	std::cout << "  Seed: " << checkpoints[0].Seed << std::endl;
+	std::cout << "  Checkpoint every " << settings.CheckpointIntervalSeconds << "s to "
+		<< GenerationCheckpoint::GetManifestFile(settings.ShardedOutput ? settings.OutputFile + ".NNN" : settings.OutputFile) << std::endl;
+
+	// the shards as far as their checkpoints go, the writers keep the checkpoints up to date with what is on disk
+	const auto saveShardSet = [&]()
+		{
+			ShardSetManifest shardSet;
+			shardSet.IsPackedOutput = settings.PackedOutput;
+			for (size_t outputIndex = 0; outputIndex < numOutputs; outputIndex++)
+			{
+				shardSet.Shards.push_back({ std::filesystem::path(outputFiles[outputIndex]).filename().string(),
+					checkpoints[outputIndex].FlushedEntries, checkpoints[outputIndex].FlushedBytes });
+			}
+			shardSet.Save(ShardSetManifest::GetManifestFile(settings.OutputFile));
+		};
+
 	SharedGameGenState sharedGameState;
 	sharedGameState.TotalGames = settings.NumGames;
+	sharedGameState.Seed = checkpoints[0].Seed;
+	sharedGameState.ResumedGames = resumedGames;
+	sharedGameState.GamesCompleted = static_cast<int>(resumedGames.GetNumGames());
 	sharedGameState.StartTime = std::chrono::high_resolution_clock::now();
-	sharedGameState.OutputFile.open(settings.OutputFile, std::ios::binary);
-	if (!sharedGameState.OutputFile.is_open())
+
+	std::vector<std::unique_ptr<AsyncEntryWriter>> writers;
+	for (size_t outputIndex = 0; outputIndex < numOutputs; outputIndex++)
 	{
-		std::cerr << "Failed to open output file: " << settings.OutputFile << std::endl;
-		return;
+		writers.push_back(std::make_unique<AsyncEntryWriter>(outputFiles[outputIndex], settings.PackedOutput,
+			&checkpoints[outputIndex], settings.CheckpointIntervalSeconds));
+		if (!writers.back()->IsOpen())
+		{
+			std::cerr << "Failed to open output file: " << outputFiles[outputIndex] << std::endl;
+			return;
+		}
+		sharedGameState.Writers.push_back(writers.back().get());
 	}
+	if (settings.ShardedOutput)
+		saveShardSet();
 
-	const int gamesPerThread = settings.NumGames / settings.NumThreads;
-	const int remainder = settings.NumGames % settings.NumThreads;
+	sharedGameState.WorkerFinishTimes.resize(settings.NumThreads);
 
 	std::vector<std::thread> threads;
 	for (int threadIndex = 0; threadIndex < settings.NumThreads; threadIndex++)
-	{
-		const int gamesForThread = gamesPerThread + (threadIndex < remainder ? 1 : 0);
-		threads.emplace_back(GameGenThreadWorker, std::cref(settings), threadIndex, gamesForThread, std::ref(sharedGameState), book.get());
-	}
+		threads.emplace_back(GameGenThreadWorker, std::cref(settings), threadIndex, std::ref(sharedGameState), book.get());
 
 	for (auto& thread : threads)
 		thread.join();
 
-	sharedGameState.OutputFile.close();
+	for (auto& writer : writers)
+		writer->Stop();
 
 	if (sharedGameState.Exception)
 		std::rethrow_exception(sharedGameState.Exception);
+	for (const auto& writer : writers)
+		writer->RethrowIfFailed();
+
+	if (settings.ShardedOutput)
+		saveShardSet();
 
 	const auto endTime = std::chrono::high_resolution_clock::now();
 	const double totalSeconds = std::chrono::duration<double>(endTime - sharedGameState.StartTime).count();
@@ -436,4 +553,15 @@ inline void RunGameGeneration(const GameGenerationSettings& settings)
 	std::cout << "Done. " << settings.NumGames << " games, " << totalPositions << " positions in "
 		<< std::fixed << std::setprecision(1) << totalSeconds << "s"
 		<< " (" << finalGamesPerSecond << " g/s, " << std::setprecision(0) << finalPositionsPerSecond << " pos/s)" << std::endl;
+	double writeSeconds = 0;
+	for (const auto& writer : writers)
+		writeSeconds += writer->GetWriteSeconds();
+	std::cout << "  Writer busy " << std::setprecision(1) << writeSeconds << "s, workers blocked on io "
+		<< double(sharedGameState.IoBlockedNanoseconds.load()) * 1e-9 << "s" << std::endl;
+
+	const TimePoint lastFinishTime = *std::max_element(sharedGameState.WorkerFinishTimes.begin(), sharedGameState.WorkerFinishTimes.end());
+	std::cout << "  Tail idle per thread:";
+	for (const auto& finishTime : sharedGameState.WorkerFinishTimes)
+		std::cout << " " << std::chrono::duration<double>(lastFinishTime - finishTime).count() << "s";
+	std::cout << std::endl;
 }
@@ -1,10 +1,20 @@
 #pragma once
+#include "GameGeneration/data_tool.h"
 #include "GameGeneration/game_generation.h"
+#include "GameGeneration/generation_checkpoint.h"
+#include "GameGeneration/packed_data.h"
+#include "GameGeneration/position_entry_reader.h"
+#include "GameGeneration/shard_set.h"
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <exception>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 inline bool TestGameGeneration()
 {
@@ -29,6 +39,7 @@ inline bool TestGameGeneration()
 	{
 		std::cout << "Game generation failed: " << ex.what() << std::endl;
 		std::remove(testOutputFile.c_str());
+		std::remove(GenerationCheckpoint::GetManifestFile(testOutputFile).c_str());
 		return false;
 	}
 
@@ -39,7 +50,30 @@ inline bool TestGameGeneration()
 	}
 
 	const auto fileSize = std::filesystem::file_size(testOutputFile);
+	const GenerationCheckpoint checkpoint = GenerationCheckpoint::Load(testOutputFile);
+	const bool isCheckpointComplete = checkpoint.FlushedBytes == fileSize &&
+		checkpoint.CompletedGames.GetNumGames() == NUM_GAMES && checkpoint.CompletedGames.GetEndOfRange(0) == NUM_GAMES;
+	size_t numInvalidEntries = 0;
+	bool isPackedRoundTripExact = true;
+	{
+		const PositionEntryReader reader(testOutputFile);
+		for (const auto& entry : reader)
+			numInvalidEntries += ValidatePositionEntry(entry) != nullptr;
+
+		if (numInvalidEntries == 0)
+		{
+			std::vector<uint8_t> packedBytes;
+			PackedChunkHeader packedHeader;
+			EncodePackedChunk(reader.GetEntries(), 0, packedBytes, packedHeader);
+
+			std::vector<PositionEntry> unpackedEntries(packedHeader.NumEntries);
+			DecodePackedChunk(packedBytes, packedHeader, unpackedEntries.data());
+			isPackedRoundTripExact = packedHeader.NumGames == NUM_GAMES && unpackedEntries.size() == reader.GetNumEntries() &&
+				std::memcmp(unpackedEntries.data(), reader.begin(), reader.GetNumEntries() * sizeof(PositionEntry)) == 0;
+		}
+	}
 	std::remove(testOutputFile.c_str());
+	std::remove(GenerationCheckpoint::GetManifestFile(testOutputFile).c_str());
 
 	if (fileSize == 0)
 	{
@@ -54,7 +88,282 @@ inline bool TestGameGeneration()
 		return false;
 	}
 
+	if (numInvalidEntries != 0)
+	{
+		std::cout << "Game generation test failed: " << numInvalidEntries << " invalid entries" << std::endl;
+		return false;
+	}
+
+	if (!isCheckpointComplete)
+	{
+		std::cout << "Game generation test failed: manifest doesn't cover the whole output" << std::endl;
+		return false;
+	}
+
+	if (!isPackedRoundTripExact)
+	{
+		std::cout << "Game generation test failed: packed entries don't unpack to the originals" << std::endl;
+		return false;
+	}
+
 	const auto numPositions = fileSize / sizeof(PositionEntry);
 	std::cout << "Game generation test passed: " << numPositions << " positions in " << NUM_GAMES << " games" << std::endl;
 	return true;
 }
+
+// every thread writes its own shard, read back through the shard set manifest as one dataset
+inline bool TestShardedGameGeneration()
+{
+	constexpr int NUM_GAMES = 10;
+	constexpr int NUM_THREADS = 2;
+	const std::string testOutputFile = "test_gamegen_sharded.bin";
+
+	std::cout << "Running sharded game generation test: " << NUM_GAMES << " games on " << NUM_THREADS << " threads\n";
+
+	GameGenerationSettings settings;
+	settings.NumGames = NUM_GAMES;
+	settings.NumThreads = NUM_THREADS;
+	settings.MaxDepth = 2;
+	settings.NumRandomMovesInOpening = 4;
+	settings.MaxGameLength = 50;
+	settings.OutputFile = testOutputFile;
+	settings.ShardedOutput = true;
+
+	const auto removeOutput = [&]()
+		{
+			for (int shardIndex = 0; shardIndex < NUM_THREADS; shardIndex++)
+			{
+				const std::string shardFile = ShardSetManifest::GetShardFile(testOutputFile, shardIndex);
+				std::remove(shardFile.c_str());
+				std::remove(GenerationCheckpoint::GetManifestFile(shardFile).c_str());
+			}
+			std::remove(ShardSetManifest::GetManifestFile(testOutputFile).c_str());
+		};
+
+	size_t numEntries = 0;
+	size_t numInvalidEntries = 0;
+	size_t numShardEntries = 0;
+	bool isIndexingConsistent = true;
+	bool isUncheckpointedTailRefused = false;
+	try
+	{
+		RunGameGeneration(settings);
+
+		const ShardedPositionEntryReader reader(ShardSetManifest::GetManifestFile(testOutputFile));
+		numEntries = reader.GetNumEntries();
+		for (size_t entryIndex = 0; entryIndex < numEntries; entryIndex++)
+			numInvalidEntries += ValidatePositionEntry(reader[entryIndex]) != nullptr;
+
+		size_t firstEntry = 0;
+		for (size_t shardIndex = 0; shardIndex < reader.GetNumShards(); shardIndex++)
+		{
+			const PositionEntryReader& shard = reader.GetShard(shardIndex);
+			for (size_t entryIndex = 0; entryIndex < shard.GetNumEntries(); entryIndex++)
+				isIndexingConsistent &= &reader[firstEntry + entryIndex] == &shard[entryIndex];
+			firstEntry += shard.GetNumEntries();
+		}
+		numShardEntries = firstEntry;
+
+		// a shard past its manifest, like one a crashed or still running worker is writing to, mustn't be read
+		{
+			std::ofstream shard(ShardSetManifest::GetShardFile(testOutputFile, 0), std::ios::binary | std::ios::app);
+			const PositionEntry unflushedEntry{};
+			shard.write(reinterpret_cast<const char*>(&unflushedEntry), sizeof(unflushedEntry));
+		}
+		try
+		{
+			ExpandShardSets({ ShardSetManifest::GetManifestFile(testOutputFile) }, false);
+		}
+		catch (const std::runtime_error&)
+		{
+			isUncheckpointedTailRefused = true;
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << "Sharded game generation failed: " << ex.what() << std::endl;
+		removeOutput();
+		return false;
+	}
+	removeOutput();
+
+	if (numEntries == 0 || numShardEntries != numEntries || !isIndexingConsistent)
+	{
+		std::cout << "Sharded game generation test failed: shards don't add up to " << numEntries << " entries" << std::endl;
+		return false;
+	}
+
+	if (numInvalidEntries != 0)
+	{
+		std::cout << "Sharded game generation test failed: " << numInvalidEntries << " invalid entries" << std::endl;
+		return false;
+	}
+
+	if (!isUncheckpointedTailRefused)
+	{
+		std::cout << "Sharded game generation test failed: a shard longer than its manifest was read" << std::endl;
+		return false;
+	}
+
+	std::cout << "Sharded game generation test passed: " << numEntries << " positions in " << NUM_GAMES << " games" << std::endl;
+	return true;
+}
+
+// a run stopped at a checkpoint of a bigger one, with unflushed bytes past it like after a crash, is resumed to the end
+// the checkpointed games stay as they were and only the rest are played
+inline bool TestResumedGameGeneration()
+{
+	constexpr int NUM_CHECKPOINTED_GAMES = 4;
+	constexpr int NUM_GAMES = 10;
+	const std::string testOutputFile = "test_gamegen_resumed.bin";
+
+	std::cout << "Running resumed game generation test: " << NUM_CHECKPOINTED_GAMES << " of " << NUM_GAMES << " games checkpointed\n";
+
+	GameGenerationSettings settings;
+	settings.NumGames = NUM_CHECKPOINTED_GAMES;
+	settings.NumThreads = 1;
+	settings.MaxDepth = 2;
+	settings.NumRandomMovesInOpening = 4;
+	settings.MaxGameLength = 50;
+	settings.OutputFile = testOutputFile;
+	settings.Seed = 12345;
+
+	const auto removeOutput = [&]()
+		{
+			std::remove(testOutputFile.c_str());
+			std::remove(GenerationCheckpoint::GetManifestFile(testOutputFile).c_str());
+		};
+
+	GenerationCheckpoint interruptedCheckpoint;
+	GenerationCheckpoint resumedCheckpoint;
+	std::vector<PositionEntry> checkpointedEntries;
+	std::vector<PositionEntry> resumedEntries;
+	size_t numInvalidEntries = 0;
+	uint64_t resumedFileSize = 0;
+	try
+	{
+		RunGameGeneration(settings);
+		interruptedCheckpoint = GenerationCheckpoint::Load(testOutputFile);
+		{
+			const PositionEntryReader reader(testOutputFile);
+			checkpointedEntries.assign(reader.begin(), reader.end());
+		}
+
+		// half an entry the crashed run wrote after its last checkpoint
+		{
+			std::ofstream output(testOutputFile, std::ios::binary | std::ios::app);
+			const std::vector<char> unflushedBytes(sizeof(PositionEntry) / 2, 'x');
+			output.write(unflushedBytes.data(), static_cast<std::streamsize>(unflushedBytes.size()));
+		}
+
+		settings.NumGames = NUM_GAMES;
+		settings.Seed = 0;
+		settings.Resume = true;
+		RunGameGeneration(settings);
+
+		resumedCheckpoint = GenerationCheckpoint::Load(testOutputFile);
+		resumedFileSize = std::filesystem::file_size(testOutputFile);
+		const PositionEntryReader reader(testOutputFile);
+		resumedEntries.assign(reader.begin(), reader.end());
+		for (const auto& entry : resumedEntries)
+			numInvalidEntries += ValidatePositionEntry(entry) != nullptr;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << "Resumed game generation failed: " << ex.what() << std::endl;
+		removeOutput();
+		return false;
+	}
+	removeOutput();
+
+	if (interruptedCheckpoint.CompletedGames.ToString() != "0-" + std::to_string(NUM_CHECKPOINTED_GAMES) ||
+		resumedCheckpoint.CompletedGames.GetNumGames() != NUM_GAMES ||
+		resumedCheckpoint.CompletedGames.ToString() != "0-" + std::to_string(NUM_GAMES))
+	{
+		std::cout << "Resumed game generation test failed: completed ranges " << resumedCheckpoint.CompletedGames.ToString()
+			<< " after resuming from " << interruptedCheckpoint.CompletedGames.ToString() << std::endl;
+		return false;
+	}
+
+	if (resumedCheckpoint.Seed != interruptedCheckpoint.Seed || resumedCheckpoint.FlushedBytes != resumedFileSize ||
+		resumedCheckpoint.FlushedEntries != resumedEntries.size() || resumedFileSize % sizeof(PositionEntry) != 0)
+	{
+		std::cout << "Resumed game generation test failed: manifest doesn't cover the " << resumedFileSize << " byte output" << std::endl;
+		return false;
+	}
+
+	if (resumedEntries.size() <= checkpointedEntries.size() ||
+		std::memcmp(resumedEntries.data(), checkpointedEntries.data(), checkpointedEntries.size() * sizeof(PositionEntry)) != 0)
+	{
+		std::cout << "Resumed game generation test failed: the checkpointed games weren't kept as they were" << std::endl;
+		return false;
+	}
+
+	if (numInvalidEntries != 0)
+	{
+		std::cout << "Resumed game generation test failed: " << numInvalidEntries << " invalid entries" << std::endl;
+		return false;
+	}
+
+	std::cout << "Resumed game generation test passed: " << resumedEntries.size() << " positions in " << NUM_GAMES << " games" << std::endl;
+	return true;
+}
+
+// scores are fed ply by ply from alternating sides, like PlayOneGame does
+inline bool TestGameAdjudication()
+{
+	GameGenerationSettings settings;
+	settings.WinAdjudicationPlies = 4;
+	settings.WinAdjudicationScore = 900;
+	settings.DrawAdjudicationPlies = 4;
+	settings.DrawAdjudicationScore = 10;
+	settings.DrawAdjudicationStartPly = 10;
+
+	// white relative scores from ply 0, returns the result and the ply it was adjudicated at
+	const auto adjudicate = [&](const std::vector<int32_t>& whiteScores, const int randomPly = -1)
+		{
+			GameAdjudicator adjudicator(settings);
+			for (int ply = 0; ply < int(whiteScores.size()); ply++)
+			{
+				const Color sideToMove = ply % 2 ? BLACK : WHITE;
+				const Score score = static_cast<Score>(sideToMove == WHITE ? whiteScores[ply] : -whiteScores[ply]);
+				const GameResult result = adjudicator.Update(score, sideToMove, ply, ply == randomPly);
+				if (result != GameResult::UNKNOWN)
+					return std::pair(result, ply);
+			}
+			return std::pair(GameResult::UNKNOWN, int(whiteScores.size()));
+		};
+
+	struct AdjudicationTestCase
+	{
+		const char* Name;
+		std::vector<int32_t> WhiteScores;
+		int RandomPly;
+		GameResult ExpectedResult;
+		int ExpectedPly;
+	};
+
+	const AdjudicationTestCase testCases[] = {
+		{ "white win", { 100, 950, 920, 1000, 990, 990 }, -1, GameResult::WHITE_WIN, 4 },
+		{ "black win", { -950, -950, -950, -950 }, -1, GameResult::BLACK_WIN, 3 },
+		{ "interrupted win", { 950, 950, 950, 500, 950, 950, 950 }, -1, GameResult::UNKNOWN, 7 },
+		{ "sides disagree", { 950, -950, 950, -950, 950, -950 }, -1, GameResult::UNKNOWN, 6 },
+		{ "random move", { 950, 950, 950, 950, 950 }, 2, GameResult::UNKNOWN, 5 },
+		{ "early draw", { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, -1, GameResult::UNKNOWN, 10 },
+		{ "draw", { 0, 0, 0, 0, 0, 0, 0, 0, 5, -5, 0, 3, 10, -10 }, -1, GameResult::DRAW, 13 },
+	};
+
+	for (const auto& testCase : testCases)
+	{
+		const auto [result, ply] = adjudicate(testCase.WhiteScores, testCase.RandomPly);
+		if (result != testCase.ExpectedResult || ply != testCase.ExpectedPly)
+		{
+			std::cout << "Game adjudication test failed: " << testCase.Name << " ended with result " << static_cast<uint32_t>(result)
+				<< " at ply " << ply << ", expected " << static_cast<uint32_t>(testCase.ExpectedResult) << " at ply " << testCase.ExpectedPly << std::endl;
+			return false;
+		}
+	}
+
+	std::cout << "Game adjudication test passed" << std::endl;
+	return true;
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include "Hardware/file_sync.h"
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// sorted disjoint [start, end) ranges of game indices, games finish out of order but mostly close to each other,
+// so a whole run collapses into a handful of ranges
+class GameIndexRanges
+{
+public:
+	forceinline void Add(const int gameIndex);
+	// the ranges of both, which must not have games in common
+	forceinline void Merge(const GameIndexRanges& other);
+	forceinline bool Contains(const int gameIndex) const;
+	// end of the range gameIndex is in, gameIndex itself if it isn't in any
+	forceinline int GetEndOfRange(const int gameIndex) const;
+	forceinline size_t GetNumGames() const { return m_NumGames; }
+
+	forceinline std::string ToString() const;
+	forceinline static GameIndexRanges Parse(const std::string& text);
+
+private:
+	// start to end
+	std::map<int, int> m_Ranges;
+	size_t m_NumGames = 0;
+};
+
+// how far a game generation run got, kept next to the output as OutputFile + MANIFEST_EXTENSION
+// everything up to FlushedBytes is whole write buffers, so truncating the output there leaves exactly CompletedGames in it
+// the manifest is written to a temporary file and renamed over the old one, a crash mid save keeps the previous checkpoint
+// the output has to be synced up to FlushedBytes before Save, the manifest must not get to the disk ahead of the data
+struct GenerationCheckpoint
+{
+	inline static constexpr const char* MANIFEST_EXTENSION = ".manifest";
+	inline static constexpr uint32_t MANIFEST_VERSION = 1;
+
+	// every game's seed is derived from this and its index, a resumed run plays the remaining games it would have played
+	uint64_t Seed = 0;
+	bool IsPackedOutput = false;
+	uint64_t FlushedBytes = 0;
+	uint64_t FlushedEntries = 0;
+	GameIndexRanges CompletedGames;
+
+	forceinline void Save(const std::string& outputFile) const;
+	forceinline static GenerationCheckpoint Load(const std::string& outputFile);
+	forceinline static std::string GetManifestFile(const std::string& outputFile) { return outputFile + MANIFEST_EXTENSION; }
+};
+
+forceinline uint64_t GetGameSeed(const uint64_t runSeed, const int gameIndex)
+{
+	return runSeed + (static_cast<uint64_t>(gameIndex) + 1) * 0x9E3779B97F4A7C15ULL;
+}
+
+
+forceinline void GameIndexRanges::Add(const int gameIndex)
+{
+	DEBUG_ASSERT(!Contains(gameIndex));
+	m_NumGames++;
+
+	auto next = m_Ranges.upper_bound(gameIndex);
+	const bool joinsNext = next != m_Ranges.end() && next->first == gameIndex + 1;
+	if (next != m_Ranges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->second == gameIndex)
+		{
+			previous->second = joinsNext ? next->second : gameIndex + 1;
+			if (joinsNext)
+				m_Ranges.erase(next);
+			return;
+		}
+	}
+
+	const int end = joinsNext ? next->second : gameIndex + 1;
+	if (joinsNext)
+		m_Ranges.erase(next);
+	m_Ranges.emplace(gameIndex, end);
+}
+
+forceinline void GameIndexRanges::Merge(const GameIndexRanges& other)
+{
+	for (const auto& [start, end] : other.m_Ranges)
+	{
+		DEBUG_ASSERT(GetEndOfRange(start) == start);
+		const auto range = m_Ranges.emplace(start, end).first;
+		m_NumGames += size_t(end - start);
+
+		// join with the neighbours the new range touches
+		const auto next = std::next(range);
+		if (next != m_Ranges.end() && next->first == range->second)
+		{
+			range->second = next->second;
+			m_Ranges.erase(next);
+		}
+		if (range != m_Ranges.begin() && std::prev(range)->second == range->first)
+		{
+			std::prev(range)->second = range->second;
+			m_Ranges.erase(range);
+		}
+	}
+}
+
+forceinline bool GameIndexRanges::Contains(const int gameIndex) const
+{
+	return GetEndOfRange(gameIndex) != gameIndex;
+}
+
+forceinline int GameIndexRanges::GetEndOfRange(const int gameIndex) const
+{
+	const auto next = m_Ranges.upper_bound(gameIndex);
+	if (next == m_Ranges.begin() || std::prev(next)->second <= gameIndex)
+		return gameIndex;
+	return std::prev(next)->second;
+}
+
+forceinline std::string GameIndexRanges::ToString() const
+{
+	std::string text;
+	for (const auto& [start, end] : m_Ranges)
+		text += (text.empty() ? "" : " ") + std::to_string(start) + "-" + std::to_string(end);
+	return text;
+}
+
+forceinline GameIndexRanges GameIndexRanges::Parse(const std::string& text)
+{
+	GameIndexRanges ranges;
+	std::istringstream stream(text);
+	std::string range;
+	while (stream >> range)
+	{
+		const size_t separator = range.find('-');
+		if (separator == std::string::npos)
+			throw std::runtime_error("invalid game range " + range);
+
+		const int start = std::stoi(range.substr(0, separator));
+		const int end = std::stoi(range.substr(separator + 1));
+		if (end <= start || (!ranges.m_Ranges.empty() && start <= std::prev(ranges.m_Ranges.end())->second))
+			throw std::runtime_error("invalid game range " + range);
+
+		ranges.m_Ranges.emplace(start, end);
+		ranges.m_NumGames += size_t(end - start);
+	}
+	return ranges;
+}
+
+forceinline void GenerationCheckpoint::Save(const std::string& outputFile) const
+{
+	const std::string manifestFile = GetManifestFile(outputFile);
+	const std::string temporaryFile = manifestFile + ".tmp";
+	{
+		std::ofstream manifest(temporaryFile);
+		if (!manifest.is_open())
+			throw std::runtime_error("could not open " + temporaryFile + " for writing");
+
+		manifest << "version " << MANIFEST_VERSION << "\n"
+			<< "seed " << Seed << "\n"
+			<< "packed " << (IsPackedOutput ? 1 : 0) << "\n"
+			<< "flushed_bytes " << FlushedBytes << "\n"
+			<< "flushed_entries " << FlushedEntries << "\n"
+			<< "completed_games " << CompletedGames.GetNumGames() << "\n"
+			<< "completed_ranges " << CompletedGames.ToString() << "\n";
+		manifest.close();
+		if (manifest.fail())
+			throw std::runtime_error("failed writing " + temporaryFile);
+	}
+	ReplaceFileDurably(temporaryFile, manifestFile);
+}
+
+forceinline GenerationCheckpoint GenerationCheckpoint::Load(const std::string& outputFile)
+{
+	const std::string manifestFile = GetManifestFile(outputFile);
+	std::ifstream manifest(manifestFile);
+	if (!manifest.is_open())
+		throw std::runtime_error("could not open " + manifestFile);
+
+	GenerationCheckpoint checkpoint;
+	uint32_t version = 0;
+	size_t numCompletedGames = 0;
+	std::string key;
+	while (manifest >> key)
+	{
+		if (key == "version")
+			manifest >> version;
+		else if (key == "seed")
+			manifest >> checkpoint.Seed;
+		else if (key == "packed")
+			manifest >> checkpoint.IsPackedOutput;
+		else if (key == "flushed_bytes")
+			manifest >> checkpoint.FlushedBytes;
+		else if (key == "flushed_entries")
+			manifest >> checkpoint.FlushedEntries;
+		else if (key == "completed_games")
+			manifest >> numCompletedGames;
+		else if (key == "completed_ranges")
+		{
+			std::string ranges;
+			std::getline(manifest, ranges);
+			checkpoint.CompletedGames = GameIndexRanges::Parse(ranges);
+		}
+		else
+			throw std::runtime_error(manifestFile + " has an unknown key " + key);
+	}
+
+	if (version != MANIFEST_VERSION || manifest.bad() || numCompletedGames != checkpoint.CompletedGames.GetNumGames())
+		throw std::runtime_error(manifestFile + " is not a valid game generation manifest");
+	return checkpoint;
+}
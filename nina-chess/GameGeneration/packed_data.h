@@ -0,0 +1,465 @@
+#pragma once
+#include "Chess/castling.h"
+#include "Chess/color.h"
+#include "Chess/move.h"
+#include "Chess/piece.h"
+#include "Chess/position.h"
+#include "Chess/side.h"
+#include "Core/Engine/bit_manip.h"
+#include "Core/Engine/utils.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
+#include "Eval/score.h"
+#include "GameGeneration/data_tool.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/position_entry_reader.h"
+#include "Hardware/intrinsics.h"
+#include "Hardware/mapped_file.h"
+#include "MoveGen/move_gen.h"
+#include "MoveGen/move_list.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// compact storage for game generation output, around 4 bytes per position instead of sizeof(PositionEntry)
+// an entry's BestMove is the move that was played from it, so every entry of a game after the first is the previous one
+// with its move made, and everything else (the move list bitboards included) is regenerated by GenerateMoves on decode
+//
+// file:     PackedDataHeader, then chunks, each a PackedChunkHeader followed by NumBytes of games
+// game:     uint16 number of entries, uint8 result, keyframe, then per entry a uint16 packed move and an int16 score
+// keyframe: uint8 side to move | castling << 1, uint8 en passant square (NO_EN_PASSANT_SQUARE if none),
+//           uint64 occupancy, then a Piece nibble for every occupied square from a1 upwards
+//
+// chunks don't depend on each other, they are encoded and decoded one per thread
+// games aren't marked in raw files, the encoder starts a new game whenever an entry doesn't follow from the previous one
+
+// PACKED_DATA_MAGIC is with PositionEntryReader, which has to recognise packed files to refuse them
+inline constexpr uint32_t PACKED_DATA_VERSION = 1;
+inline constexpr size_t PACKED_CHUNK_ENTRIES = 1 << 16;
+inline constexpr size_t MAX_PACKED_GAME_ENTRIES = UINT16_MAX;
+inline constexpr uint8_t NO_EN_PASSANT_SQUARE = uint8_t(NUM_BOARD_SQUARES);
+inline constexpr size_t PACKED_ENTRY_SIZE = sizeof(uint16_t) + sizeof(int16_t);
+
+struct PackedDataHeader
+{
+	uint32_t Magic = PACKED_DATA_MAGIC;
+	uint32_t Version = PACKED_DATA_VERSION;
+	// entries are unpacked to this size, a different PositionEntry layout can't read the file
+	uint32_t EntrySize = sizeof(PositionEntry);
+};
+
+struct PackedChunkHeader
+{
+	uint32_t NumBytes;
+	uint32_t NumGames;
+	uint32_t NumEntries;
+};
+
+template<typename T>
+forceinline void AppendPacked(std::vector<uint8_t>& bytes, const T value)
+{
+	const size_t offset = bytes.size();
+	bytes.resize(offset + sizeof(T));
+	std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+forceinline T ReadPacked(const uint8_t*& data, const uint8_t* end)
+{
+	if (size_t(end - data) < sizeof(T))
+		throw std::runtime_error("packed data is truncated or corrupted");
+
+	T value;
+	std::memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return value;
+}
+
+forceinline Position PositionFromEntry(const PositionEntry& entry)
+{
+	const uint64_t* features = entry.Features;
+	const auto side = [features](const size_t start)
+		{
+			return Side(features[start + PAWN], features[start + KNIGHT], features[start + BISHOP],
+				features[start + ROOK], features[start + QUEEN], features[start + KING]);
+		};
+
+	return Position(side(ChessBitboardFeatureIterator::WHITE_PIECES_START), side(ChessBitboardFeatureIterator::BLACK_PIECES_START),
+		features[ChessBitboardFeatureIterator::EN_PASSANT_INDEX], Castling(uint32_t(features[ChessBitboardFeatureIterator::CASTLING_INDEX])),
+		Color(entry.SideToMove), 0);
+}
+
+forceinline void AppendKeyframe(std::vector<uint8_t>& bytes, const Position& position)
+{
+	AppendPacked<uint8_t>(bytes, uint8_t(position.SideToMove | (position.CastlingPermissions.CurrentCastlingPermissions << 1)));
+	AppendPacked<uint8_t>(bytes, position.EnPassantSquare ? uint8_t(BitIndex(position.EnPassantSquare)) : NO_EN_PASSANT_SQUARE);
+	AppendPacked<uint64_t>(bytes, position.OccupiedBitmask);
+
+	size_t numPieces = 0;
+	for (Bitboard occupied = position.OccupiedBitmask; occupied; numPieces++)
+	{
+		const Bitboard square = PopBit(occupied);
+		const Side& side = (position.WhitePieces.Pieces & square) ? position.WhitePieces : position.BlackPieces;
+		uint8_t piece = (&side == &position.BlackPieces) ? uint8_t(BLACK_PAWN) : uint8_t(WHITE_PAWN);
+		for (PieceType pieceType = PAWN; !(side.GetPieceBitboard(pieceType) & square); pieceType++)
+			piece++;
+
+		if (numPieces % 2 == 0)
+			bytes.push_back(piece);
+		else
+			bytes.back() |= piece << 4;
+	}
+}
+
+forceinline Position ReadKeyframe(const uint8_t*& data, const uint8_t* end)
+{
+	const uint8_t flags = ReadPacked<uint8_t>(data, end);
+	const uint8_t enPassantSquare = ReadPacked<uint8_t>(data, end);
+	const Bitboard occupancy = ReadPacked<uint64_t>(data, end);
+
+	const size_t numPieces = Popcnt(occupancy);
+	if (size_t(end - data) < (numPieces + 1) / 2 || enPassantSquare > NO_EN_PASSANT_SQUARE)
+		throw std::runtime_error("packed data is truncated or corrupted");
+
+	Side whitePieces;
+	Side blackPieces;
+	size_t pieceIndex = 0;
+	for (Bitboard occupied = occupancy; occupied; pieceIndex++)
+	{
+		const Bitboard square = PopBit(occupied);
+		const uint32_t piece = (data[pieceIndex / 2] >> ((pieceIndex % 2) * 4)) & 0xF;
+		if (piece >= PIECE_NONE)
+			throw std::runtime_error("packed data is truncated or corrupted");
+
+		Side& side = piece < BLACK_PAWN ? whitePieces : blackPieces;
+		side.GetPieceBitboard(PieceType(piece % PIECE_TYPE_NONE)) |= square;
+	}
+	data += (numPieces + 1) / 2;
+
+	// move generation assumes a king per side
+	if (Popcnt(whitePieces.King) != 1 || Popcnt(blackPieces.King) != 1)
+		throw std::runtime_error("packed data is truncated or corrupted");
+
+	return Position(Side(whitePieces.Pawns, whitePieces.Knights, whitePieces.Bishops, whitePieces.Rooks, whitePieces.Queens, whitePieces.King),
+		Side(blackPieces.Pawns, blackPieces.Knights, blackPieces.Bishops, blackPieces.Rooks, blackPieces.Queens, blackPieces.King),
+		enPassantSquare == NO_EN_PASSANT_SQUARE ? 0ULL : 1ULL << enPassantSquare, Castling(uint32_t(flags >> 1) & 0b1111), Color(flags & 1), 0);
+}
+
+// the entry the decoder rebuilds out of a position, compared bytewise against the original before anything is packed
+forceinline PositionEntry RebuildPositionEntry(const Position& position, const MoveList& moveList, const Score score, const Move& move, const uint32_t result)
+{
+	PositionEntry entry = PackPosition(position, moveList.MoveListMisc, score, move);
+	entry.Result = result;
+	return entry;
+}
+
+forceinline bool IsSameEntry(const PositionEntry& left, const PositionEntry& right)
+{
+	return std::memcmp(&left, &right, sizeof(PositionEntry)) == 0;
+}
+
+// NULL_MOVE has a promotion piece of PIECE_TYPE_NONE, it is stored as 0 instead of its own packed form
+forceinline uint16_t PackMoveOrNull(const Move& move)
+{
+	return move ? move.ToPackedMove() : 0;
+}
+
+// NULL_MOVE for 0 or if no legal move packs to packedMove
+forceinline Move FindPackedMove(const MoveList& moveList, const uint16_t packedMove)
+{
+	if (!packedMove)
+		return NULL_MOVE;
+
+	for (uint32_t moveIndex = 0; moveIndex < moveList.GetNumMoves(); moveIndex++)
+		if (moveList[moveIndex].ToPackedMove() == packedMove)
+			return moveList[moveIndex];
+	return NULL_MOVE;
+}
+
+// appends the games of entries to bytes and fills in header, throws if an entry can't be unpacked to exactly itself
+inline void EncodePackedChunk(const std::span<const PositionEntry> entries, const size_t firstEntryIndex,
+	std::vector<uint8_t>& bytes, PackedChunkHeader& header)
+{
+	const auto fail = [firstEntryIndex](const size_t entryIndex, const std::string& reason)
+		{
+			throw std::runtime_error("entry " + std::to_string(firstEntryIndex + entryIndex) + " can't be packed: " + reason);
+		};
+
+	MoveList moveList;
+	Position position;
+	Position nextPosition;
+	Move playedMove = NULL_MOVE;
+	uint32_t gameResult = uint32_t(GameResult::UNKNOWN);
+	size_t gameHeaderOffset = 0;
+	uint16_t numGameEntries = 0;
+	const size_t firstByte = bytes.size();
+	header = { 0, 0, uint32_t(entries.size()) };
+
+	for (size_t entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+	{
+		const PositionEntry& entry = entries[entryIndex];
+		if (const char* reason = ValidatePositionEntry(entry))
+			fail(entryIndex, reason);
+
+		bool continuesGame = false;
+		if (playedMove && entry.Result == gameResult && numGameEntries < MAX_PACKED_GAME_ENTRIES)
+		{
+			Position::MakeMove(position, nextPosition, playedMove);
+			GenerateMoves(nextPosition, moveList);
+			continuesGame = IsSameEntry(RebuildPositionEntry(nextPosition, moveList, entry.SearchScore, entry.BestMove, entry.Result), entry);
+			if (continuesGame)
+				position = nextPosition;
+		}
+
+		if (!continuesGame)
+		{
+			position = PositionFromEntry(entry);
+			GenerateMoves(position, moveList);
+			if (!IsSameEntry(RebuildPositionEntry(position, moveList, entry.SearchScore, entry.BestMove, entry.Result), entry))
+				fail(entryIndex, "its move list bitboards don't match the move generator");
+
+			header.NumGames++;
+			gameHeaderOffset = bytes.size();
+			numGameEntries = 0;
+			gameResult = entry.Result;
+			AppendPacked<uint16_t>(bytes, 0);
+			AppendPacked<uint8_t>(bytes, uint8_t(gameResult));
+			AppendKeyframe(bytes, position);
+		}
+
+		if (entry.BestMove && !(FindPackedMove(moveList, entry.BestMove.ToPackedMove()) == entry.BestMove))
+			fail(entryIndex, "its best move isn't legal");
+
+		AppendPacked<uint16_t>(bytes, PackMoveOrNull(entry.BestMove));
+		AppendPacked<int16_t>(bytes, int16_t(entry.SearchScore));
+		numGameEntries++;
+		std::memcpy(bytes.data() + gameHeaderOffset, &numGameEntries, sizeof(numGameEntries));
+		playedMove = entry.BestMove;
+	}
+
+	header.NumBytes = uint32_t(bytes.size() - firstByte);
+}
+
+// packs entries into as many chunks as it takes, appended headers included so bytes can be written to a file as is
+inline void AppendPackedChunks(const std::span<const PositionEntry> entries, std::vector<uint8_t>& bytes)
+{
+	for (size_t firstEntry = 0; firstEntry < entries.size(); firstEntry += PACKED_CHUNK_ENTRIES)
+	{
+		const size_t headerOffset = bytes.size();
+		PackedChunkHeader header{};
+		AppendPacked(bytes, header);
+		EncodePackedChunk(entries.subspan(firstEntry, std::min(PACKED_CHUNK_ENTRIES, entries.size() - firstEntry)), firstEntry, bytes, header);
+		std::memcpy(bytes.data() + headerOffset, &header, sizeof(header));
+	}
+}
+
+// entries has to have room for header.NumEntries entries
+inline void DecodePackedChunk(const std::span<const uint8_t> bytes, const PackedChunkHeader& header, PositionEntry* entries)
+{
+	const uint8_t* data = bytes.data();
+	const uint8_t* end = data + bytes.size();
+
+	MoveList moveList;
+	Position nextPosition;
+	size_t numDecodedEntries = 0;
+
+	for (uint32_t gameIndex = 0; gameIndex < header.NumGames; gameIndex++)
+	{
+		const uint16_t numGameEntries = ReadPacked<uint16_t>(data, end);
+		const uint8_t result = ReadPacked<uint8_t>(data, end);
+		Position position = ReadKeyframe(data, end);
+		if (numDecodedEntries + numGameEntries > header.NumEntries || size_t(end - data) < size_t(numGameEntries) * PACKED_ENTRY_SIZE)
+			throw std::runtime_error("packed data is truncated or corrupted");
+
+		Move playedMove = NULL_MOVE;
+		for (uint16_t gameEntryIndex = 0; gameEntryIndex < numGameEntries; gameEntryIndex++)
+		{
+			if (gameEntryIndex)
+			{
+				if (!playedMove)
+					throw std::runtime_error("packed data is truncated or corrupted");
+				Position::MakeMove(position, nextPosition, playedMove);
+				position = nextPosition;
+			}
+			GenerateMoves(position, moveList);
+
+			const uint16_t packedMove = ReadPacked<uint16_t>(data, end);
+			const int16_t score = ReadPacked<int16_t>(data, end);
+			playedMove = FindPackedMove(moveList, packedMove);
+			if (packedMove && !playedMove)
+				throw std::runtime_error("packed data is truncated or corrupted");
+
+			entries[numDecodedEntries++] = RebuildPositionEntry(position, moveList, Score(score), playedMove, result);
+		}
+	}
+
+	if (data != end || numDecodedEntries != header.NumEntries)
+		throw std::runtime_error("packed data is truncated or corrupted");
+}
+
+// runs work(threadIndex) on numThreads threads and rethrows the first exception any of them threw
+template<typename Work>
+inline void RunPackingThreads(const size_t numThreads, const Work& work)
+{
+	std::exception_ptr exception;
+	std::mutex exceptionMutex;
+	std::vector<std::thread> threads;
+	for (size_t threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		threads.emplace_back([&, threadIndex]()
+			{
+				try
+				{
+					work(threadIndex);
+				}
+				catch (...)
+				{
+					const std::lock_guard<std::mutex> lock(exceptionMutex);
+					if (!exception)
+						exception = std::current_exception();
+				}
+			});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+forceinline void WritePackedDataHeader(std::ofstream& output)
+{
+	const PackedDataHeader header;
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+forceinline void WritePackedChunk(std::ofstream& output, const PackedChunkHeader& header, const std::vector<uint8_t>& bytes)
+{
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+inline void PackPositionEntries(const std::vector<std::string>& inputFiles, const std::string& outputFile, const size_t numThreads)
+{
+	std::ofstream output(outputFile, std::ios::binary);
+	if (!output.is_open())
+		throw std::runtime_error("could not open " + outputFile + " for writing");
+	WritePackedDataHeader(output);
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	uint64_t numEntries = 0;
+	uint64_t numGames = 0;
+	std::vector<std::vector<uint8_t>> chunkBytes(numThreads);
+	std::vector<PackedChunkHeader> chunkHeaders(numThreads);
+
+	for (const auto& inputFile : inputFiles)
+	{
+		const PositionEntryReader reader(inputFile);
+		if (reader.GetNumTrailingBytes())
+			std::cout << inputFile << ": ignoring " << reader.GetNumTrailingBytes() << " trailing bytes of a truncated entry" << std::endl;
+
+		// every thread packs one chunk of the window, the chunks are written in order once all of them are done
+		for (size_t windowStart = 0; windowStart < reader.GetNumEntries(); windowStart += numThreads * PACKED_CHUNK_ENTRIES)
+		{
+			const size_t numChunks = std::min(numThreads, (reader.GetNumEntries() - windowStart + PACKED_CHUNK_ENTRIES - 1) / PACKED_CHUNK_ENTRIES);
+			RunPackingThreads(numChunks, [&](const size_t chunkIndex)
+				{
+					const size_t firstEntry = windowStart + chunkIndex * PACKED_CHUNK_ENTRIES;
+					const size_t numChunkEntries = std::min(PACKED_CHUNK_ENTRIES, reader.GetNumEntries() - firstEntry);
+					chunkBytes[chunkIndex].clear();
+					EncodePackedChunk(reader.GetRange(firstEntry, numChunkEntries), firstEntry, chunkBytes[chunkIndex], chunkHeaders[chunkIndex]);
+				});
+
+			for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+			{
+				WritePackedChunk(output, chunkHeaders[chunkIndex], chunkBytes[chunkIndex]);
+				numEntries += chunkHeaders[chunkIndex].NumEntries;
+				numGames += chunkHeaders[chunkIndex].NumGames;
+			}
+		}
+	}
+
+	output.close();
+	if (output.fail())
+		throw std::runtime_error("failed writing " + outputFile);
+
+	const double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	const uint64_t packedBytes = std::filesystem::file_size(outputFile);
+	std::cout << "Packed " << numEntries << " entries of " << numGames << " games into " << outputFile << ": "
+		<< std::fixed << std::setprecision(2) << double(packedBytes) / double(std::max<uint64_t>(numEntries, 1)) << " bytes per entry, "
+		<< std::setprecision(1) << double(numEntries * sizeof(PositionEntry)) / double(std::max<uint64_t>(packedBytes, 1)) << "x smaller ("
+		<< elapsedSeconds << "s)" << std::defaultfloat << std::endl;
+}
+
+inline void UnpackPositionEntries(const std::vector<std::string>& inputFiles, const std::string& outputFile, const size_t numThreads)
+{
+	std::ofstream output(outputFile, std::ios::binary);
+	if (!output.is_open())
+		throw std::runtime_error("could not open " + outputFile + " for writing");
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	uint64_t numEntries = 0;
+	std::vector<std::vector<PositionEntry>> chunkEntries(numThreads);
+
+	for (const auto& inputFile : inputFiles)
+	{
+		const MappedFile file(inputFile);
+		const uint8_t* data = file.GetData();
+		const uint8_t* end = data + file.GetSize();
+
+		const PackedDataHeader fileHeader = ReadPacked<PackedDataHeader>(data, end);
+		if (fileHeader.Magic != PACKED_DATA_MAGIC || fileHeader.Version != PACKED_DATA_VERSION)
+			throw std::runtime_error(inputFile + " is not a packed data file");
+		if (fileHeader.EntrySize != sizeof(PositionEntry))
+			throw std::runtime_error(inputFile + " was packed with a different entry format");
+
+		// chunk headers are tiny and found by skipping over the games, the decoding is what gets split across threads
+		std::vector<std::pair<PackedChunkHeader, const uint8_t*>> chunks;
+		while (data != end)
+		{
+			const PackedChunkHeader chunkHeader = ReadPacked<PackedChunkHeader>(data, end);
+			if (size_t(end - data) < chunkHeader.NumBytes)
+				throw std::runtime_error(inputFile + " is truncated or corrupted");
+			chunks.emplace_back(chunkHeader, data);
+			data += chunkHeader.NumBytes;
+		}
+
+		for (size_t windowStart = 0; windowStart < chunks.size(); windowStart += numThreads)
+		{
+			const size_t numChunks = std::min(numThreads, chunks.size() - windowStart);
+			RunPackingThreads(numChunks, [&](const size_t chunkIndex)
+				{
+					const auto& [chunkHeader, chunkData] = chunks[windowStart + chunkIndex];
+					chunkEntries[chunkIndex].resize(chunkHeader.NumEntries);
+					DecodePackedChunk({ chunkData, chunkHeader.NumBytes }, chunkHeader, chunkEntries[chunkIndex].data());
+				});
+
+			for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+			{
+				output.write(reinterpret_cast<const char*>(chunkEntries[chunkIndex].data()),
+					static_cast<std::streamsize>(chunkEntries[chunkIndex].size() * sizeof(PositionEntry)));
+				numEntries += chunkEntries[chunkIndex].size();
+			}
+		}
+	}
+
+	output.close();
+	if (output.fail())
+		throw std::runtime_error("failed writing " + outputFile);
+
+	const double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	std::cout << "Unpacked " << numEntries << " entries into " << outputFile << " ("
+		<< std::fixed << std::setprecision(1) << elapsedSeconds << "s, "
+		<< std::setprecision(0) << double(numEntries) / std::max(elapsedSeconds, 1e-9) << " entries/s)" << std::defaultfloat << std::endl;
+}
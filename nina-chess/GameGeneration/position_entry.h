@@ -0,0 +1,61 @@
+#pragma once
+#include "Chess/move.h"
+#include "Chess/position.h"
+#include "Core/Engine/utils.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
+#include "Eval/score.h"
+#include "MoveGen/move_list.h"
+#include <cstdint>
+#include <cstring>
+
+enum class GameResult : uint32_t
+{
+	BLACK_WIN = 0,
+	DRAW = 1,
+	WHITE_WIN = 2,
+	UNKNOWN = 255
+};
+
+// one training position as written to the game generation output files, the files are these records back to back
+struct PositionEntry
+{
+	uint64_t Features[ChessBitboardFeatureIterator::NumBitboardFeatures()];
+	Score SearchScore;
+	Move BestMove;
+	uint32_t Result;
+	uint32_t SideToMove;
+};
+
+// the layout is read directly from disk (and by scripts/shuffle_data.py), changing it breaks existing data
+static_assert(sizeof(PositionEntry) == 216, "PositionEntry is an on-disk format");
+
+forceinline PositionEntry PackPosition(const Position& position, const MoveListMiscellaneous& moveListMisc,
+	const Score score, const Move& bestMove)
+{
+	PositionEntry entry{};
+
+	std::memcpy(
+		&entry.Features[ChessBitboardFeatureIterator::WHITE_PIECES_START],
+		&position.WhitePieces.Pawns,
+		ChessBitboardFeatureIterator::NUM_SIDE_FEATURES * sizeof(uint64_t));
+
+	std::memcpy(
+		&entry.Features[ChessBitboardFeatureIterator::BLACK_PIECES_START],
+		&position.BlackPieces.Pawns,
+		ChessBitboardFeatureIterator::NUM_SIDE_FEATURES * sizeof(uint64_t));
+
+	entry.Features[ChessBitboardFeatureIterator::EN_PASSANT_INDEX] = position.EnPassantSquare;
+	entry.Features[ChessBitboardFeatureIterator::CASTLING_INDEX] = position.CastlingPermissions.CurrentCastlingPermissions;
+
+	std::memcpy(
+		&entry.Features[ChessBitboardFeatureIterator::MOVELIST_MISC_START],
+		&moveListMisc.PieceMoves[0],
+		ChessBitboardFeatureIterator::NUM_MOVELIST_MISC_FEATURES * sizeof(uint64_t));
+
+	entry.SearchScore = score;
+	entry.BestMove = bestMove;
+	entry.SideToMove = static_cast<uint32_t>(position.SideToMove);
+	entry.Result = static_cast<uint32_t>(GameResult::UNKNOWN);
+
+	return entry;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include "GameGeneration/position_entry.h"
+#include "Hardware/mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// every packed_data.h file starts with it, no raw file can as its first bytes are white pawns on the first rank
+inline constexpr uint32_t PACKED_DATA_MAGIC = 0x4B50434E; // "NCPK"
+
+// zero copy view of a game generation output file, the entries are read straight out of the mapping
+// the os pages the file in as it is touched, so files far larger than memory can be streamed through
+// a truncated last entry (a generator killed mid write) is not part of the view, GetNumTrailingBytes tells it was there
+// packed files are refused, read as raw entries they would be garbage
+class PositionEntryReader
+{
+public:
+	forceinline PositionEntryReader(const std::string_view& filename);
+
+	forceinline size_t GetNumEntries() const { return m_NumEntries; }
+	forceinline size_t GetNumTrailingBytes() const { return m_File.GetSize() - m_NumEntries * sizeof(PositionEntry); }
+
+	forceinline const PositionEntry& operator[](const size_t entryIndex) const { DEBUG_ASSERT(entryIndex < m_NumEntries); return m_Entries[entryIndex]; }
+	forceinline const PositionEntry* begin() const { return m_Entries; }
+	forceinline const PositionEntry* end() const { return m_Entries + m_NumEntries; }
+
+	forceinline std::span<const PositionEntry> GetEntries() const { return { m_Entries, m_NumEntries }; }
+	forceinline std::span<const PositionEntry> GetRange(const size_t firstEntry, const size_t numEntries) const;
+	// splits the file into numShards contiguous ranges whose sizes differ by at most one entry, for one thread each
+	forceinline std::span<const PositionEntry> GetShard(const size_t shardIndex, const size_t numShards) const;
+
+private:
+	MappedFile m_File;
+	const PositionEntry* m_Entries;
+	size_t m_NumEntries;
+};
+
+
+forceinline PositionEntryReader::PositionEntryReader(const std::string_view& filename) :
+	m_File(filename),
+	m_Entries(reinterpret_cast<const PositionEntry*>(m_File.GetData())),
+	m_NumEntries(m_File.GetSize() / sizeof(PositionEntry))
+{
+	uint32_t magic = 0;
+	if (m_File.GetSize() >= sizeof(magic))
+		std::memcpy(&magic, m_File.GetData(), sizeof(magic));
+	if (magic == PACKED_DATA_MAGIC)
+		throw std::runtime_error(std::string(filename) + " is a packed data file, unpack it first with datatool unpack");
+}
+
+forceinline std::span<const PositionEntry> PositionEntryReader::GetRange(const size_t firstEntry, const size_t numEntries) const
+{
+	DEBUG_ASSERT(firstEntry <= m_NumEntries && numEntries <= m_NumEntries - firstEntry);
+	return { m_Entries + firstEntry, numEntries };
+}
+
+forceinline std::span<const PositionEntry> PositionEntryReader::GetShard(const size_t shardIndex, const size_t numShards) const
+{
+	DEBUG_ASSERT(shardIndex < numShards);
+
+	const size_t entriesPerShard = m_NumEntries / numShards;
+	const size_t numLargerShards = m_NumEntries % numShards;
+
+	// the first numLargerShards shards take one of the leftover entries each
+	const size_t firstEntry = shardIndex * entriesPerShard + (shardIndex < numLargerShards ? shardIndex : numLargerShards);
+	const size_t numEntries = entriesPerShard + (shardIndex < numLargerShards ? 1 : 0);
+	return GetRange(firstEntry, numEntries);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "Chess/color.h"
+#include "Chess/move.h"
+#include "Core/Engine/utils.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
+#include "Eval/evaluator.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/position_entry_reader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+inline constexpr size_t RESCORE_CHUNK_ENTRIES = 1 << 16;
+
+// replaces the search scores of already generated entries with the static eval of the current weights
+// terminal entries (no best move) keep their mate/draw score, the eval can't see those
+inline void RescorePositionEntries(Evaluator& evaluator, PositionEntry* entries, const size_t numEntries)
+{
+	static_assert(Evaluator::NUM_FEATURE_BITBOARDS == ChessBitboardFeatureIterator::NumBitboardFeatures());
+
+	std::vector<Bitboard> features(numEntries * Evaluator::NUM_FEATURE_BITBOARDS);
+	std::vector<float> wdlChances(numEntries);
+	for (size_t entryIndex = 0; entryIndex < numEntries; entryIndex++)
+	{
+		std::memcpy(&features[entryIndex * Evaluator::NUM_FEATURE_BITBOARDS], entries[entryIndex].Features, sizeof(entries[entryIndex].Features));
+	}
+
+	evaluator.EvaluateBatch(features.data(), numEntries, wdlChances.data());
+
+	for (size_t entryIndex = 0; entryIndex < numEntries; entryIndex++)
+	{
+		PositionEntry& entry = entries[entryIndex];
+		if (entry.BestMove == NULL_MOVE)
+			continue;
+
+		const float sideToMoveChances = entry.SideToMove == static_cast<uint32_t>(WHITE) ? wdlChances[entryIndex] : -wdlChances[entryIndex];
+		entry.SearchScore = GetScore(sideToMoveChances);
+	}
+}
+
+// writes every entry of the input files to outputFile with its score replaced by the eval of weightsFile
+// a single evaluator rescores everything, every evaluator loads the weights with its own random jitter
+// so evaluators on separate threads wouldn't agree on the scores
+inline void RescorePositionEntryFiles(const std::vector<std::string>& inputFiles, const std::string& outputFile, const std::string& weightsFile)
+{
+	if (!std::ifstream(weightsFile).is_open())
+		throw std::runtime_error("could not open weights file " + weightsFile);
+
+	std::ofstream output(outputFile, std::ios::binary);
+	if (!output.is_open())
+		throw std::runtime_error("could not open " + outputFile + " for writing");
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const auto evaluator = std::make_unique<Evaluator>(weightsFile);
+	std::vector<PositionEntry> chunkEntries;
+	uint64_t numEntries = 0;
+
+	for (const auto& inputFile : inputFiles)
+	{
+		const PositionEntryReader reader(inputFile);
+		if (reader.GetNumTrailingBytes())
+			std::cout << inputFile << ": ignoring " << reader.GetNumTrailingBytes() << " trailing bytes of a truncated entry" << std::endl;
+
+		for (size_t firstEntry = 0; firstEntry < reader.GetNumEntries(); firstEntry += RESCORE_CHUNK_ENTRIES)
+		{
+			const auto entries = reader.GetRange(firstEntry, std::min(RESCORE_CHUNK_ENTRIES, reader.GetNumEntries() - firstEntry));
+			chunkEntries.assign(entries.begin(), entries.end());
+			RescorePositionEntries(*evaluator, chunkEntries.data(), chunkEntries.size());
+
+			output.write(reinterpret_cast<const char*>(chunkEntries.data()), static_cast<std::streamsize>(chunkEntries.size() * sizeof(PositionEntry)));
+			numEntries += chunkEntries.size();
+		}
+	}
+
+	output.close();
+	if (output.fail())
+		throw std::runtime_error("failed writing " + outputFile);
+
+	const double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	std::cout << "Rescored " << numEntries << " entries into " << outputFile << " with " << weightsFile << " ("
+		<< std::fixed << std::setprecision(1) << elapsedSeconds << "s, "
+		<< std::setprecision(0) << double(numEntries) / std::max(elapsedSeconds, 1e-9) << " entries/s)" << std::defaultfloat << std::endl;
+}
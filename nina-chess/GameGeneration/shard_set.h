@@ -0,0 +1,250 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include "GameGeneration/packed_data.h"
+#include "GameGeneration/position_entry.h"
+#include "GameGeneration/position_entry_reader.h"
+#include "Hardware/file_sync.h"
+#include "Hardware/mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// a sharded game generation run gives every worker its own output file, OutputFile.000, OutputFile.001, ...
+// so they never share a file or a writer, and lists them in OutputFile + SHARD_SET_EXTENSION
+// the manifest is written as soon as the shards are created, with what their checkpoints hold, and again once the run is done,
+// until then the shards are longer than the manifest says and every reader of the set refuses them,
+// the games past a checkpoint may be cut off mid game and aren't in it
+// the shards together are one dataset, games don't span shards and which worker played a game doesn't matter
+
+struct OutputShard
+{
+	// relative to the directory of the manifest, the shard set can be moved around as a whole
+	std::string File;
+	uint64_t NumEntries;
+	uint64_t NumBytes;
+};
+
+struct ShardSetManifest
+{
+	inline static constexpr const char* SHARD_SET_EXTENSION = ".shards";
+	inline static constexpr uint32_t SHARD_SET_VERSION = 1;
+
+	bool IsPackedOutput = false;
+	std::vector<OutputShard> Shards;
+
+	forceinline uint64_t GetNumEntries() const;
+	// paths of the shards, usable from the current directory
+	forceinline std::vector<std::string> GetShardFiles(const std::string& manifestFile) const;
+
+	forceinline void Save(const std::string& manifestFile) const;
+	forceinline static ShardSetManifest Load(const std::string& manifestFile);
+	forceinline static std::string GetManifestFile(const std::string& outputFile) { return outputFile + SHARD_SET_EXTENSION; }
+	forceinline static std::string GetShardFile(const std::string& outputFile, const size_t shardIndex);
+	forceinline static bool IsManifestFile(const std::string& file) { return file.ends_with(SHARD_SET_EXTENSION); }
+};
+
+// a shard set read as if it was a single file, entry indices run through the shards in order
+class ShardedPositionEntryReader
+{
+public:
+	forceinline ShardedPositionEntryReader(const std::string& manifestFile);
+
+	forceinline size_t GetNumEntries() const { return m_FirstEntries.back(); }
+	forceinline size_t GetNumShards() const { return m_Shards.size(); }
+	forceinline const PositionEntryReader& GetShard(const size_t shardIndex) const { return *m_Shards[shardIndex]; }
+
+	forceinline const PositionEntry& operator[](const size_t entryIndex) const;
+
+private:
+	std::vector<std::unique_ptr<PositionEntryReader>> m_Shards;
+	// prefix sums of the shard sizes, one more than there are shards
+	std::vector<size_t> m_FirstEntries;
+};
+
+// shard set manifests among files are replaced by their shards, so every datatool command takes either
+// a command reads either raw or packed files, a shard set of the other format is refused instead of being misread
+forceinline std::vector<std::string> ExpandShardSets(const std::vector<std::string>& files, const bool isPackedInput);
+// concatenates the shards into a single file of the same format
+inline void MergeShardSet(const std::string& manifestFile, const std::string& outputFile);
+
+
+forceinline uint64_t ShardSetManifest::GetNumEntries() const
+{
+	uint64_t numEntries = 0;
+	for (const auto& shard : Shards)
+		numEntries += shard.NumEntries;
+	return numEntries;
+}
+
+forceinline std::vector<std::string> ShardSetManifest::GetShardFiles(const std::string& manifestFile) const
+{
+	const std::filesystem::path directory = std::filesystem::path(manifestFile).parent_path();
+	std::vector<std::string> files;
+	for (const auto& shard : Shards)
+		files.push_back((directory / shard.File).string());
+	return files;
+}
+
+forceinline void ShardSetManifest::Save(const std::string& manifestFile) const
+{
+	const std::string temporaryFile = manifestFile + ".tmp";
+	{
+		std::ofstream manifest(temporaryFile);
+		if (!manifest.is_open())
+			throw std::runtime_error("could not open " + temporaryFile + " for writing");
+
+		manifest << "version " << SHARD_SET_VERSION << "\n"
+			<< "packed " << (IsPackedOutput ? 1 : 0) << "\n"
+			<< "shards " << Shards.size() << "\n";
+		// the file name goes last, it is the rest of the line and may have spaces in it
+		for (const auto& shard : Shards)
+			manifest << "shard " << shard.NumEntries << " " << shard.NumBytes << " " << shard.File << "\n";
+		manifest.close();
+		if (manifest.fail())
+			throw std::runtime_error("failed writing " + temporaryFile);
+	}
+	ReplaceFileDurably(temporaryFile, manifestFile);
+}
+
+forceinline ShardSetManifest ShardSetManifest::Load(const std::string& manifestFile)
+{
+	std::ifstream manifest(manifestFile);
+	if (!manifest.is_open())
+		throw std::runtime_error("could not open " + manifestFile);
+
+	ShardSetManifest shardSet;
+	uint32_t version = 0;
+	size_t numShards = 0;
+	std::string key;
+	while (manifest >> key)
+	{
+		if (key == "version")
+			manifest >> version;
+		else if (key == "packed")
+			manifest >> shardSet.IsPackedOutput;
+		else if (key == "shards")
+			manifest >> numShards;
+		else if (key == "shard")
+		{
+			OutputShard shard;
+			manifest >> shard.NumEntries >> shard.NumBytes;
+			manifest.ignore(1);
+			std::getline(manifest, shard.File);
+			shardSet.Shards.push_back(shard);
+		}
+		else
+			throw std::runtime_error(manifestFile + " has an unknown key " + key);
+	}
+
+	if (version != SHARD_SET_VERSION || manifest.bad() || numShards != shardSet.Shards.size())
+		throw std::runtime_error(manifestFile + " is not a valid shard set manifest");
+	return shardSet;
+}
+
+forceinline std::string ShardSetManifest::GetShardFile(const std::string& outputFile, const size_t shardIndex)
+{
+	std::string index = std::to_string(shardIndex);
+	if (index.size() < 3)
+		index.insert(0, 3 - index.size(), '0');
+	return outputFile + "." + index;
+}
+
+forceinline ShardedPositionEntryReader::ShardedPositionEntryReader(const std::string& manifestFile)
+{
+	const ShardSetManifest shardSet = ShardSetManifest::Load(manifestFile);
+	if (shardSet.IsPackedOutput)
+		throw std::runtime_error(manifestFile + " is a packed shard set, unpack it first");
+
+	m_FirstEntries.push_back(0);
+	for (const auto& shardFile : shardSet.GetShardFiles(manifestFile))
+	{
+		m_Shards.push_back(std::make_unique<PositionEntryReader>(shardFile));
+		const OutputShard& shard = shardSet.Shards[m_Shards.size() - 1];
+		if (m_Shards.back()->GetNumEntries() != shard.NumEntries || m_Shards.back()->GetNumTrailingBytes())
+			throw std::runtime_error(shardFile + " doesn't match its shard set manifest");
+		m_FirstEntries.push_back(m_FirstEntries.back() + shard.NumEntries);
+	}
+}
+
+forceinline const PositionEntry& ShardedPositionEntryReader::operator[](const size_t entryIndex) const
+{
+	DEBUG_ASSERT(entryIndex < GetNumEntries());
+	const size_t shardIndex = size_t(std::upper_bound(m_FirstEntries.begin(), m_FirstEntries.end(), entryIndex) - m_FirstEntries.begin()) - 1;
+	return (*m_Shards[shardIndex])[entryIndex - m_FirstEntries[shardIndex]];
+}
+
+forceinline std::vector<std::string> ExpandShardSets(const std::vector<std::string>& files, const bool isPackedInput)
+{
+	std::vector<std::string> expandedFiles;
+	for (const auto& file : files)
+	{
+		if (!ShardSetManifest::IsManifestFile(file))
+		{
+			expandedFiles.push_back(file);
+			continue;
+		}
+
+		const ShardSetManifest shardSet = ShardSetManifest::Load(file);
+		if (shardSet.IsPackedOutput && !isPackedInput)
+			throw std::runtime_error(file + " is a packed shard set, unpack it first with datatool unpack");
+		if (!shardSet.IsPackedOutput && isPackedInput)
+			throw std::runtime_error(file + " is not a packed shard set");
+
+		const auto shardFiles = shardSet.GetShardFiles(file);
+		for (size_t shardIndex = 0; shardIndex < shardFiles.size(); shardIndex++)
+		{
+			if (std::filesystem::file_size(shardFiles[shardIndex]) != shardSet.Shards[shardIndex].NumBytes)
+				throw std::runtime_error(shardFiles[shardIndex] + " doesn't match its shard set manifest, finish or resume the run that writes it first");
+		}
+		expandedFiles.insert(expandedFiles.end(), shardFiles.begin(), shardFiles.end());
+	}
+	return expandedFiles;
+}
+
+inline void MergeShardSet(const std::string& manifestFile, const std::string& outputFile)
+{
+	const ShardSetManifest shardSet = ShardSetManifest::Load(manifestFile);
+	const auto shardFiles = shardSet.GetShardFiles(manifestFile);
+
+	std::ofstream output(outputFile, std::ios::binary);
+	if (!output.is_open())
+		throw std::runtime_error("could not open " + outputFile + " for writing");
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	// every packed shard starts with its own file header, the merged file keeps one and the chunks of all of them
+	if (shardSet.IsPackedOutput)
+		WritePackedDataHeader(output);
+
+	for (size_t shardIndex = 0; shardIndex < shardFiles.size(); shardIndex++)
+	{
+		const MappedFile file(shardFiles[shardIndex]);
+		if (file.GetSize() != shardSet.Shards[shardIndex].NumBytes)
+			throw std::runtime_error(shardFiles[shardIndex] + " doesn't match its shard set manifest");
+
+		const uint8_t* data = file.GetData();
+		const uint8_t* end = data + file.GetSize();
+		if (shardSet.IsPackedOutput)
+		{
+			const PackedDataHeader header = ReadPacked<PackedDataHeader>(data, end);
+			if (header.Magic != PACKED_DATA_MAGIC || header.Version != PACKED_DATA_VERSION || header.EntrySize != sizeof(PositionEntry))
+				throw std::runtime_error(shardFiles[shardIndex] + " is not a packed data file of this version");
+		}
+		output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(end - data));
+	}
+
+	output.close();
+	if (output.fail())
+		throw std::runtime_error("failed writing " + outputFile);
+
+	const double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	std::cout << "Merged " << shardFiles.size() << " shards, " << shardSet.GetNumEntries() << " entries into " << outputFile
+		<< " (" << std::fixed << std::setprecision(1) << elapsedSeconds << "s)" << std::defaultfloat << std::endl;
+}
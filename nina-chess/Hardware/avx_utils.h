@@ -1,9 +1,11 @@
 #pragma once
 #include "Core/Engine/utils.h"
 #include "Hardware/simd.h"
+#include <cstdint>
 #include <immintrin.h>
 
 forceinline float SimdHorizontalSum(const SimdVector& input);
+forceinline int32_t SimdIntHorizontalSum(const SimdIntVector& input);
 
 #ifdef __AVX512F__
 forceinline float SimdHorizontalSum(const SimdVector& input)
@@ -105,3 +107,39 @@ forceinline float SimdHorizontalSum(const SimdVector& input)
 	return _mm_cvtss_f32(sum);
 }
 #endif
+
+#ifdef __AVX512BW__
+forceinline int32_t SimdIntHorizontalSum(const SimdIntVector& input)
+{
+	// same halving as the float version, the 512 bit vector is folded into 256 bits first
+	const __m256i sum256 = _mm256_add_epi32(_mm512_castsi512_si256(input), _mm512_extracti32x8_epi32(input, 1));
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sum256), _mm256_extracti128_si256(sum256, 1));
+
+	// sum = [x0+x2,x1+x3 ...]
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	// sum = [x0+x1+x2+x3 ...]
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+#elifdef __AVX2__
+forceinline int32_t SimdIntHorizontalSum(const SimdIntVector& input)
+{
+	// sum = [x0+x4,x1+x5,x2+x6,x3+x7]
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(input), _mm256_extracti128_si256(input, 1));
+
+	// sum = [x0+x4+x2+x6,x1+x5+x3+x7 ...]
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	// sum = [x0+x1+x2+x3+x4+x5+x6+x7 ...]
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+#else
+forceinline int32_t SimdIntHorizontalSum(const SimdIntVector& input)
+{
+	// sum = [x0+x2,x1+x3 ...]
+	__m128i sum = _mm_add_epi32(input, _mm_shuffle_epi32(input, _MM_SHUFFLE(1, 0, 3, 2)));
+	// sum = [x0+x1+x2+x3 ...]
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// a flushed stream only got its data to the os, these make sure it is on the disk and survives a power loss
+// a manifest describing a file must only be saved once the file itself is synced, or after a crash it can promise data that isn't there
+
+// waits until everything written to the file so far, by any handle, is on the disk
+forceinline void SyncFile(const std::string& filename);
+// renames temporaryFile over file once its contents are synced, a crash leaves either the old or the new file in place
+forceinline void ReplaceFileDurably(const std::string& temporaryFile, const std::string& file);
+
+
+#if defined(_WIN32)
+forceinline void SyncFile(const std::string& filename)
+{
+	const HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("could not open " + filename + " to sync it");
+
+	const bool isSynced = FlushFileBuffers(file);
+	CloseHandle(file);
+	if (!isSynced)
+		throw std::runtime_error("failed syncing " + filename);
+}
+
+// ntfs journals the rename itself, a directory can't be synced like a posix one
+forceinline void syncDirectory(const std::filesystem::path&) {}
+#else
+forceinline void SyncFile(const std::string& filename)
+{
+	const int file = open(filename.c_str(), O_RDONLY);
+	if (file == -1)
+		throw std::runtime_error("could not open " + filename + " to sync it");
+
+	const bool isSynced = fsync(file) == 0;
+	close(file);
+	if (!isSynced)
+		throw std::runtime_error("failed syncing " + filename);
+}
+
+// a rename is only durable once the directory holding the new name is synced as well
+forceinline void syncDirectory(const std::filesystem::path& directory)
+{
+	const std::string directoryName = directory.empty() ? "." : directory.string();
+	const int file = open(directoryName.c_str(), O_RDONLY | O_DIRECTORY);
+	if (file == -1)
+		throw std::runtime_error("could not open " + directoryName + " to sync it");
+
+	const bool isSynced = fsync(file) == 0;
+	close(file);
+	if (!isSynced)
+		throw std::runtime_error("failed syncing " + directoryName);
+}
+#endif
+
+forceinline void ReplaceFileDurably(const std::string& temporaryFile, const std::string& file)
+{
+	SyncFile(temporaryFile);
+	std::filesystem::rename(temporaryFile, file);
+	syncDirectory(std::filesystem::path(file).parent_path());
+}
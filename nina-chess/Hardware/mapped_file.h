@@ -0,0 +1,128 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// how a mapping will be read, so the os reads ahead through the file or only pages in what is touched
+enum class FileAccess
+{
+	SEQUENTIAL,
+	RANDOM
+};
+
+// read only view of a whole file, the os pages it in on demand instead of it being read up front
+class MappedFile
+{
+public:
+	forceinline MappedFile(const std::string_view& filename, const FileAccess access = FileAccess::SEQUENTIAL);
+	forceinline ~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	forceinline const uint8_t* GetData() const { return m_Data; }
+	forceinline size_t GetSize() const { return m_Size; }
+
+private:
+	const uint8_t* m_Data;
+	size_t m_Size;
+#if defined(_WIN32)
+	HANDLE m_File;
+	HANDLE m_Mapping;
+#endif
+};
+
+
+#if defined(_WIN32)
+forceinline MappedFile::MappedFile(const std::string_view& filename, const FileAccess access) :
+	m_Data(nullptr),
+	m_Size(0),
+	m_File(INVALID_HANDLE_VALUE),
+	m_Mapping(nullptr)
+{
+	m_File = CreateFileA(std::string(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, access == FileAccess::SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (m_File == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("could not open " + std::string(filename));
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(m_File, &fileSize);
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+	if (m_Size == 0)
+		return;
+
+	m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_Mapping)
+		m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_Data)
+	{
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+		CloseHandle(m_File);
+		throw std::runtime_error("could not map " + std::string(filename));
+	}
+}
+
+forceinline MappedFile::~MappedFile()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File != INVALID_HANDLE_VALUE)
+		CloseHandle(m_File);
+}
+#else
+forceinline MappedFile::MappedFile(const std::string_view& filename, const FileAccess access) :
+	m_Data(nullptr),
+	m_Size(0)
+{
+	const int fileDescriptor = open(std::string(filename).c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		throw std::runtime_error("could not open " + std::string(filename));
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("could not stat " + std::string(filename));
+	}
+	m_Size = static_cast<size_t>(fileStatus.st_size);
+
+	if (m_Size != 0)
+	{
+		void* mapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapping == MAP_FAILED)
+		{
+			close(fileDescriptor);
+			throw std::runtime_error("could not map " + std::string(filename));
+		}
+		madvise(mapping, m_Size, access == FileAccess::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+		m_Data = static_cast<const uint8_t*>(mapping);
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	close(fileDescriptor);
+}
+
+forceinline MappedFile::~MappedFile()
+{
+	if (m_Data)
+		munmap(const_cast<uint8_t*>(m_Data), m_Size);
+}
+#endif
@@ -0,0 +1,137 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// allocations that are big and randomly accessed (the transposition table) go through here
+// so they can be backed by 2 MiB pages, which cuts the TLB misses on every probe
+inline constexpr size_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// isOnLargePages tells whether the memory really is on large pages, any failure falls back to regular ones
+forceinline void* AllocateLargePages(const size_t sizeInBytes, bool& isOnLargePages);
+forceinline void FreeLargePages(void* memory);
+forceinline void InterleaveAcrossNumaNodes(void* memory, const size_t sizeInBytes);
+
+struct LargePageDeleter
+{
+	forceinline void operator()(void* memory) const { FreeLargePages(memory); }
+};
+
+
+#if defined(_WIN32)
+// MEM_LARGE_PAGES only succeeds when the process token has the "lock pages in memory" privilege enabled,
+// the account has to be granted it in the local security policy, this only switches it on for the process
+forceinline bool EnableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		return false;
+
+	TOKEN_PRIVILEGES privileges{};
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool isEnabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+		AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr);
+	// AdjustTokenPrivileges succeeds without enabling anything when the account wasn't granted the privilege
+	isEnabled = isEnabled && GetLastError() == ERROR_SUCCESS;
+	CloseHandle(token);
+	return isEnabled;
+}
+#endif
+
+forceinline void* AllocateLargePages(const size_t sizeInBytes, bool& isOnLargePages)
+{
+	const size_t alignedSize = (sizeInBytes + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE;
+	void* memory = nullptr;
+	isOnLargePages = false;
+
+#if defined(_WIN32)
+	static const bool hasLockMemoryPrivilege = EnableLockMemoryPrivilege();
+	const size_t largePageMinimum = GetLargePageMinimum();
+	if (hasLockMemoryPrivilege && largePageMinimum != 0)
+	{
+		const size_t largePageSize = (sizeInBytes + largePageMinimum - 1) / largePageMinimum * largePageMinimum;
+		memory = VirtualAlloc(nullptr, largePageSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		isOnLargePages = memory != nullptr;
+	}
+	if (!memory)
+		memory = VirtualAlloc(nullptr, alignedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	memory = std::aligned_alloc(LARGE_PAGE_SIZE, alignedSize);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	// transparent huge pages, madvise fails when THP is disabled, otherwise the kernel backs the range with them as it can
+	if (memory)
+		isOnLargePages = madvise(memory, alignedSize, MADV_HUGEPAGE) == 0;
+#endif
+#endif
+
+	if (!memory)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+forceinline void FreeLargePages(void* memory)
+{
+	if (!memory)
+		return;
+
+#if defined(_WIN32)
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	std::free(memory);
+#endif
+}
+
+forceinline void InterleaveAcrossNumaNodes([[maybe_unused]] void* memory, [[maybe_unused]] const size_t sizeInBytes)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	// /sys/devices/system/node/online is a range list such as "0" or "0-3"
+	std::ifstream onlineNodes("/sys/devices/system/node/online");
+	std::string range;
+	if (!(onlineNodes >> range))
+		return;
+
+	uint64_t nodeMask = 0;
+	size_t position = 0;
+	while (position < range.size())
+	{
+		size_t parsedLength = 0;
+		const int firstNode = std::stoi(range.substr(position), &parsedLength);
+		position += parsedLength;
+		int lastNode = firstNode;
+		if (position < range.size() && range[position] == '-')
+		{
+			lastNode = std::stoi(range.substr(position + 1), &parsedLength);
+			position += parsedLength + 1;
+		}
+		for (int node = firstNode; node <= lastNode && node < 64; node++)
+			nodeMask |= 1ULL << node;
+		position++;
+	}
+
+	// single node machines have nothing to interleave
+	if ((nodeMask & (nodeMask - 1)) == 0)
+		return;
+
+	constexpr int MPOL_INTERLEAVE = 3;
+	const size_t alignedSize = (sizeInBytes + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE;
+	// failure only means the pages end up wherever they are first touched
+	syscall(SYS_mbind, memory, alignedSize, MPOL_INTERLEAVE, &nodeMask, 64, 0);
+#endif
+}
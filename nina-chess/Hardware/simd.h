@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/Engine/utils.h"
+#include <cstdint>
 #include <immintrin.h>
 #include <xmmintrin.h>
 
@@ -13,6 +14,24 @@ using SimdVector = __m128;
 #endif
 
 inline constexpr int FLOATS_PER_REGISTER = sizeof(SimdVector) / sizeof(float);
+// architectural vector registers, kernels that keep their working set in registers size it against this
+#ifdef __AVX512F__
+inline constexpr size_t NUM_SIMD_REGISTERS = 32;
+#else
+inline constexpr size_t NUM_SIMD_REGISTERS = 16;
+#endif
+
+// integer vectors for the quantized networks, the 512 bit variants need the byte/word instructions of AVX512BW
+#ifdef __AVX512BW__
+using SimdIntVector = __m512i;
+#elifdef __AVX2__
+using SimdIntVector = __m256i;
+#else
+using SimdIntVector = __m128i;
+#endif
+
+inline constexpr int INT8_PER_REGISTER = sizeof(SimdIntVector) / sizeof(int8_t);
+inline constexpr int INT16_PER_REGISTER = sizeof(SimdIntVector) / sizeof(int16_t);
 
 struct SimdPack
 {
@@ -26,20 +45,80 @@ private:
 
 #ifdef __AVX512F__
 forceinline SimdVector SimdLoad(const float* address) { return _mm512_load_ps(address); }
+forceinline void SimdStore(float* address, const SimdVector& value) { _mm512_store_ps(address, value); }
+forceinline SimdVector SimdAdd(const SimdVector& a, const SimdVector& b) { return _mm512_add_ps(a, b); }
+forceinline SimdVector SimdSub(const SimdVector& a, const SimdVector& b) { return _mm512_sub_ps(a, b); }
 forceinline SimdVector SimdSetZero() { return _mm512_setzero_ps(); }
 forceinline SimdVector SimdMax(const SimdVector& a, const SimdVector& b) { return _mm512_max_ps(a, b); }
 forceinline SimdVector SimdTanh(const SimdVector& input) { return _mm512_tanh_ps(input); }
 forceinline SimdVector SimdFusedMultiplyAdd(const SimdVector& a, const SimdVector& b, const SimdVector& c) { return _mm512_fmadd_ps(a, b, c); }
 #elifdef __AVX2__
 forceinline SimdVector SimdLoad(const float* address) { return _mm256_load_ps(address); }
+forceinline void SimdStore(float* address, const SimdVector& value) { _mm256_store_ps(address, value); }
+forceinline SimdVector SimdAdd(const SimdVector& a, const SimdVector& b) { return _mm256_add_ps(a, b); }
+forceinline SimdVector SimdSub(const SimdVector& a, const SimdVector& b) { return _mm256_sub_ps(a, b); }
 forceinline SimdVector SimdSetZero() { return _mm256_setzero_ps(); }
 forceinline SimdVector SimdMax(const SimdVector& a, const SimdVector& b) { return _mm256_max_ps(a, b); }
 forceinline SimdVector SimdTanh(const SimdVector& input) { return _mm256_tanh_ps(input); }
 forceinline SimdVector SimdFusedMultiplyAdd(const SimdVector& a, const SimdVector& b, const SimdVector& c) { return _mm256_fmadd_ps(a, b, c); }
 #else
 forceinline SimdVector SimdLoad(const float* address) { return _mm_load_ps(address); }
+forceinline void SimdStore(float* address, const SimdVector& value) { _mm_store_ps(address, value); }
+forceinline SimdVector SimdAdd(const SimdVector& a, const SimdVector& b) { return _mm_add_ps(a, b); }
+forceinline SimdVector SimdSub(const SimdVector& a, const SimdVector& b) { return _mm_sub_ps(a, b); }
 forceinline SimdVector SimdSetZero() { return _mm_setzero_ps(); }
 forceinline SimdVector SimdMax(const SimdVector& a, const SimdVector& b) { return _mm_max_ps(a, b); }
 forceinline SimdVector SimdTanh(const SimdVector& input) { return _mm_tanh_ps(input); }
 forceinline SimdVector SimdFusedMultiplyAdd(const SimdVector& a, const SimdVector& b, const SimdVector& c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
 #endif
+
+// SimdDotProductAccumulate multiplies unsigned bytes by signed bytes and adds every group of 4 products to the int32 lanes of accumulator
+// without VNNI the products are summed in pairs into int16 first, that saturates unless the unsigned bytes stay below 128
+#ifdef __AVX512BW__
+forceinline SimdIntVector SimdIntLoad(const void* address) { return _mm512_load_si512(address); }
+forceinline void SimdIntStore(void* address, const SimdIntVector& value) { _mm512_store_si512(address, value); }
+forceinline SimdIntVector SimdAddInt16(const SimdIntVector& a, const SimdIntVector& b) { return _mm512_add_epi16(a, b); }
+forceinline SimdIntVector SimdSubInt16(const SimdIntVector& a, const SimdIntVector& b) { return _mm512_sub_epi16(a, b); }
+forceinline SimdIntVector SimdIntSetZero() { return _mm512_setzero_si512(); }
+#ifdef __AVX512VNNI__
+forceinline SimdIntVector SimdDotProductAccumulate(const SimdIntVector& accumulator, const SimdIntVector& unsignedBytes, const SimdIntVector& signedBytes)
+{
+	return _mm512_dpbusd_epi32(accumulator, unsignedBytes, signedBytes);
+}
+#else
+forceinline SimdIntVector SimdDotProductAccumulate(const SimdIntVector& accumulator, const SimdIntVector& unsignedBytes, const SimdIntVector& signedBytes)
+{
+	const SimdIntVector pairSums = _mm512_maddubs_epi16(unsignedBytes, signedBytes);
+	return _mm512_add_epi32(accumulator, _mm512_madd_epi16(pairSums, _mm512_set1_epi16(1)));
+}
+#endif
+#elifdef __AVX2__
+forceinline SimdIntVector SimdIntLoad(const void* address) { return _mm256_load_si256(static_cast<const __m256i*>(address)); }
+forceinline void SimdIntStore(void* address, const SimdIntVector& value) { _mm256_store_si256(static_cast<__m256i*>(address), value); }
+forceinline SimdIntVector SimdAddInt16(const SimdIntVector& a, const SimdIntVector& b) { return _mm256_add_epi16(a, b); }
+forceinline SimdIntVector SimdSubInt16(const SimdIntVector& a, const SimdIntVector& b) { return _mm256_sub_epi16(a, b); }
+forceinline SimdIntVector SimdIntSetZero() { return _mm256_setzero_si256(); }
+#ifdef __AVXVNNI__
+forceinline SimdIntVector SimdDotProductAccumulate(const SimdIntVector& accumulator, const SimdIntVector& unsignedBytes, const SimdIntVector& signedBytes)
+{
+	return _mm256_dpbusd_avx_epi32(accumulator, unsignedBytes, signedBytes);
+}
+#else
+forceinline SimdIntVector SimdDotProductAccumulate(const SimdIntVector& accumulator, const SimdIntVector& unsignedBytes, const SimdIntVector& signedBytes)
+{
+	const SimdIntVector pairSums = _mm256_maddubs_epi16(unsignedBytes, signedBytes);
+	return _mm256_add_epi32(accumulator, _mm256_madd_epi16(pairSums, _mm256_set1_epi16(1)));
+}
+#endif
+#else
+forceinline SimdIntVector SimdIntLoad(const void* address) { return _mm_load_si128(static_cast<const __m128i*>(address)); }
+forceinline void SimdIntStore(void* address, const SimdIntVector& value) { _mm_store_si128(static_cast<__m128i*>(address), value); }
+forceinline SimdIntVector SimdAddInt16(const SimdIntVector& a, const SimdIntVector& b) { return _mm_add_epi16(a, b); }
+forceinline SimdIntVector SimdSubInt16(const SimdIntVector& a, const SimdIntVector& b) { return _mm_sub_epi16(a, b); }
+forceinline SimdIntVector SimdIntSetZero() { return _mm_setzero_si128(); }
+forceinline SimdIntVector SimdDotProductAccumulate(const SimdIntVector& accumulator, const SimdIntVector& unsignedBytes, const SimdIntVector& signedBytes)
+{
+	const SimdIntVector pairSums = _mm_maddubs_epi16(unsignedBytes, signedBytes);
+	return _mm_add_epi32(accumulator, _mm_madd_epi16(pairSums, _mm_set1_epi16(1)));
+}
+#endif
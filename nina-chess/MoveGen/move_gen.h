@@ -20,7 +20,7 @@ template<Color color>
 forceinline constexpr Bitboard GetLegalPawnAdvances(const Bitboard pawns, const Bitboard bishopPinmask, const Bitboard rookPinmask, const Bitboard occupied);
 template<Color color>
 forceinline constexpr Bitboard GetPawnDoubleAdvances(const Bitboard singleAdvancePawnMoves, const Bitboard occupied);
-template<Color color>
+template<Color color, GenType genType = GenType::ALL>
 forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList);
 
 forceinline constexpr Bitboard GetKingMoves(const size_t kingIndex, const Bitboard attackedSquares);
@@ -92,11 +92,17 @@ forceinline constexpr Bitboard GetKingMoves(const size_t kingIndex, const Bitboa
 	return KING_MOVE_BITMASKS[kingIndex] & ~attackedSquares;
 }
 
-template<PieceType pieceType, Color color, bool isKingsideCastling = false, bool isQueensideCastling = false, bool isEnPassant = false>
+template<PieceType pieceType, Color color, bool isKingsideCastling = false, bool isQueensideCastling = false, bool isEnPassant = false, GenType genType = GenType::ALL>
 forceinline void WriteMoves(MoveList& moveList, Bitboard movesMask, const uint32_t pieceIndex, const Bitboard enemies)
 {
 	constexpr PieceType movingPieceType = pieceType;
 	moveList.MoveListMisc.PieceMoves[pieceType] |= movesMask;
+
+	if constexpr (genType == GenType::CAPTURES && (isKingsideCastling || isQueensideCastling))
+		return;
+	else if constexpr (genType == GenType::CAPTURES && !isEnPassant)
+		movesMask &= enemies;
+
 	while (movesMask)
 	{
 		const Bitboard moveTarget = PopBit(movesMask);
@@ -122,7 +128,7 @@ forceinline void WriteMoves(MoveList& moveList, Bitboard movesMask, const uint32
 	}
 }
 
-template<Color color>
+template<Color color, GenType genType>
 forceinline void WritePawnMoves(MoveList& moveList, const Bitboard leftPawnCaptures, const Bitboard rightPawnCaptures,
 	const Bitboard legalPawnAdvances, const Bitboard pawnDoubleAdvances, Bitboard pawns)
 {
@@ -160,6 +166,10 @@ forceinline void WritePawnMoves(MoveList& moveList, const Bitboard leftPawnCaptu
 		currentPawnMoves |= currentPawnNormalMoves;
 		moveList.MoveListMisc.PieceMoves[movingPieceType] |= currentPawnMoves;
 
+		// only promotions are left over from the advances when generating captures
+		if constexpr (genType == GenType::CAPTURES)
+			currentPawnNormalMoves &= PromotionRankBitmask<color>();
+
 		while (currentPawnNormalMoves)
 		{
 			const Bitboard move = PopBit(currentPawnNormalMoves);
@@ -180,6 +190,10 @@ forceinline void WritePawnMoves(MoveList& moveList, const Bitboard leftPawnCaptu
 		Bitboard currentPawnDoubleAdvances = GetDoubleAdvances<color>(pawn) & pawnDoubleAdvances;
 		currentPawnMoves |= currentPawnDoubleAdvances;
 		moveList.MoveListMisc.PieceMoves[movingPieceType] |= currentPawnMoves;
+
+		if constexpr (genType == GenType::CAPTURES)
+			continue;
+
 		while (currentPawnDoubleAdvances)
 		{
 			const Bitboard move = PopBit(currentPawnDoubleAdvances);
@@ -190,7 +204,7 @@ forceinline void WritePawnMoves(MoveList& moveList, const Bitboard leftPawnCaptu
 	}
 }
 
-template<Color color, bool isCheck, bool isUnblockableCheck>
+template<Color color, bool isCheck, bool isUnblockableCheck, GenType genType>
 forceinline void WriteSliderMoves(MoveList& moveList, Bitboard movableBishops, Bitboard movableRooks, Bitboard queens, const Bitboard occupied, const Bitboard allies,
 	const Bitboard bishopPinmask, const Bitboard rookPinmask, const Bitboard checkers, const Bitboard bishopCheckmask, const Bitboard rookCheckmask)
 {
@@ -211,7 +225,7 @@ forceinline void WriteSliderMoves(MoveList& moveList, Bitboard movableBishops, B
 			currentBishopMoves &= bishopPinmask;
 		currentBishopMoves &= ~allies;
 		if (currentBishopMoves)
-			WriteMoves<BISHOP, color>(moveList, currentBishopMoves, BitIndex(currentBishop), occupied & ~allies);
+			WriteMoves<BISHOP, color, false, false, false, genType>(moveList, currentBishopMoves, BitIndex(currentBishop), occupied & ~allies);
 	}
 	while (movableRooks)
 	{
@@ -231,7 +245,7 @@ forceinline void WriteSliderMoves(MoveList& moveList, Bitboard movableBishops, B
 			currentRookMoves &= rookPinmask;
 		currentRookMoves &= ~allies;
 		if (currentRookMoves)
-			WriteMoves<ROOK, color>(moveList, currentRookMoves, BitIndex(currentRook), occupied & ~allies);
+			WriteMoves<ROOK, color, false, false, false, genType>(moveList, currentRookMoves, BitIndex(currentRook), occupied & ~allies);
 	}
 	while (queens)
 	{
@@ -255,11 +269,11 @@ forceinline void WriteSliderMoves(MoveList& moveList, Bitboard movableBishops, B
 			currentQueenMoves &= (rookCheckmask | bishopCheckmask);
 		}
 		if (currentQueenMoves)
-			WriteMoves<QUEEN, color>(moveList, currentQueenMoves, BitIndex(currentQueen), occupied & ~allies);
+			WriteMoves<QUEEN, color, false, false, false, genType>(moveList, currentQueenMoves, BitIndex(currentQueen), occupied & ~allies);
 	}
 }
 
-template<Color color, bool isCheck, bool isUnblockableCheck>
+template<Color color, bool isCheck, bool isUnblockableCheck, GenType genType>
 forceinline void WriteKnightMoves(MoveList& moveList, Bitboard movableKnights, const Bitboard allies,
 	const Bitboard checkers, const Bitboard bishopCheckmask, const Bitboard rookCheckmask, const Bitboard enemies)
 {
@@ -278,6 +292,8 @@ forceinline void WriteKnightMoves(MoveList& moveList, Bitboard movableKnights, c
 			currentKnightMoves &= (bishopCheckmask | rookCheckmask);
 		}
 		currentKnightMoves &= ~allies;
+		if constexpr (genType == GenType::CAPTURES)
+			currentKnightMoves &= enemies;
 
 		while (currentKnightMoves)
 		{
@@ -292,11 +308,12 @@ forceinline void WriteKnightMoves(MoveList& moveList, Bitboard movableKnights, c
 	}
 }
 
-template<Color color>
+template<Color color, GenType genType>
 forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList)
 {
 	moveList.Reset();
 	moveList.SetHashOfPosition(position.Hash);
+	moveList.SetGenType(genType);
 
 	constexpr auto oppositeColor = GetOppositeColor<color>();
 	const auto& currPieces = position.GetSide<color>();
@@ -362,7 +379,7 @@ forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList
 
 	// king can always move, unless she can't
 	const Bitboard legalKingMoves = GetKingMoves(kingIndex, attackedSquares) & ~currPieces.Pieces;
-	WriteMoves<KING, color>(moveList, legalKingMoves, kingIndex, oppositePieces.Pieces);
+	WriteMoves<KING, color, false, false, false, genType>(moveList, legalKingMoves, kingIndex, oppositePieces.Pieces);
 	if (numCheckers > 1)
 	{
 		// double check. The only legal moves are king moves to run away from check, can't block it 
@@ -388,40 +405,40 @@ forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList
 	// no checks
 	if (!(knightCheckers | pawnCheckers | rookCheckers | bishopCheckers))
 	{
-		WriteSliderMoves<color, false, false>(moveList, movableBishops, movableRooks,
+		WriteSliderMoves<color, false, false, genType>(moveList, movableBishops, movableRooks,
 			currPieces.Queens, position.OccupiedBitmask, currPieces.Pieces, bishopPinmask,
 			rookPinmask, 0, 0, 0);
-		WriteKnightMoves<color, false, false>(moveList, movableKnights, currPieces.Pieces, 0,
+		WriteKnightMoves<color, false, false, genType>(moveList, movableKnights, currPieces.Pieces, 0,
 			0, 0, oppositePieces.Pieces);
 	}
 	// blockable checks
 	else if (!(knightCheckers | pawnCheckers) && (rookCheckers | bishopCheckers))
 	{
-		WriteSliderMoves<color, true, false>(moveList, movableBishops, movableRooks,
+		WriteSliderMoves<color, true, false, genType>(moveList, movableBishops, movableRooks,
 			currPieces.Queens, position.OccupiedBitmask, currPieces.Pieces, bishopPinmask,
 			rookPinmask, rookCheckers | bishopCheckers, bishopCheckmask, rookCheckmask);
 		pawnLeftCaptures &= (bishopCheckmask | rookCheckmask);
 		pawnRightCaptures &= (bishopCheckmask | rookCheckmask);
 		legalPawnAdvances &= (bishopCheckmask | rookCheckmask);
 		legalPawnDoubleAdvances &= (bishopCheckmask | rookCheckmask);
-		WriteKnightMoves<color, true, false>(moveList, movableKnights, currPieces.Pieces, rookCheckers | bishopCheckers,
+		WriteKnightMoves<color, true, false, genType>(moveList, movableKnights, currPieces.Pieces, rookCheckers | bishopCheckers,
 			bishopCheckmask, rookCheckmask, oppositePieces.Pieces);
 	}
 	// unblockable checks
 	else
 	{
-		WriteSliderMoves<color, true, true>(moveList, movableBishops, movableRooks,
+		WriteSliderMoves<color, true, true, genType>(moveList, movableBishops, movableRooks,
 			currPieces.Queens, position.OccupiedBitmask, currPieces.Pieces, bishopPinmask,
 			rookPinmask, knightCheckers | pawnCheckers, 0, 0);
 		pawnLeftCaptures &= knightCheckers | pawnCheckers;
 		pawnRightCaptures &= knightCheckers | pawnCheckers;
 		legalPawnAdvances = 0;
 		legalPawnDoubleAdvances = 0;
-		WriteKnightMoves<color, true, true>(moveList, movableKnights, currPieces.Pieces, knightCheckers | pawnCheckers,
+		WriteKnightMoves<color, true, true, genType>(moveList, movableKnights, currPieces.Pieces, knightCheckers | pawnCheckers,
 			0, 0, oppositePieces.Pieces);
 	}
 	// all bad moves have been pruned
-	WritePawnMoves<color>(moveList, pawnLeftCaptures, pawnRightCaptures, legalPawnAdvances, legalPawnDoubleAdvances, currPieces.Pawns);
+	WritePawnMoves<color, genType>(moveList, pawnLeftCaptures, pawnRightCaptures, legalPawnAdvances, legalPawnDoubleAdvances, currPieces.Pawns);
 
 
 	if (hasEP)
@@ -446,7 +463,7 @@ forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList
 			{
 				constexpr bool isCastling = false;
 				constexpr bool isEnPassant = true;
-				WriteMoves<PAWN, color, isCastling, isCastling, isEnPassant>(moveList, position.EnPassantSquare, BitIndex(enPassantCandidate), 0ULL);
+				WriteMoves<PAWN, color, isCastling, isCastling, isEnPassant, genType>(moveList, position.EnPassantSquare, BitIndex(enPassantCandidate), 0ULL);
 			}
 		}
 	}
@@ -460,7 +477,7 @@ forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList
 		{
 			constexpr bool isKingsideCastling = true;
 			constexpr bool isQueensideCastling = false;
-			WriteMoves<KING, color, isKingsideCastling, isQueensideCastling >(moveList, Castling::KingsideCastlingRookBitmask<color>(), kingIndex, oppositePieces.Pieces);
+			WriteMoves<KING, color, isKingsideCastling, isQueensideCastling, false, genType>(moveList, Castling::KingsideCastlingRookBitmask<color>(), kingIndex, oppositePieces.Pieces);
 		}
 	}
 	// queenside castling
@@ -472,7 +489,7 @@ forceinline MoveList& GenerateMoves(const Position& position, MoveList& moveList
 		{
 			constexpr bool isKingsideCastling = false;
 			constexpr bool isQueensideCastling = true;
-			WriteMoves<KING, color, isKingsideCastling, isQueensideCastling >(moveList, Castling::QueensideCastlingRookBitmask<color>(), kingIndex, oppositePieces.Pieces);
+			WriteMoves<KING, color, isKingsideCastling, isQueensideCastling, false, genType>(moveList, Castling::QueensideCastlingRookBitmask<color>(), kingIndex, oppositePieces.Pieces);
 		}
 	}
 	return moveList;
@@ -0,0 +1,82 @@
+#pragma once
+#include "Chess/color.h"
+#include "Chess/position.h"
+#include "MoveGen/move_gen.h"
+#include "MoveGen/move_list.h"
+#include "Search/perft.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// the capture list has to be exactly the captures and promotions of the full list, in the same order,
+// with identical miscellaneous data since the evaluator reads it regardless of which list it was given
+template<Color sideToMove>
+inline bool CheckCaptureGeneration(const Position& position, const size_t remainingDepth)
+{
+	constexpr Color oppositeSide = GetOppositeColor<sideToMove>();
+
+	std::unique_ptr<MoveList> allMoves = std::make_unique<MoveList>();
+	std::unique_ptr<MoveList> captures = std::make_unique<MoveList>();
+	GenerateMoves<sideToMove, GenType::ALL>(position, *allMoves);
+	GenerateMoves<sideToMove, GenType::CAPTURES>(position, *captures);
+
+	if (std::memcmp(&allMoves->MoveListMisc, &captures->MoveListMisc, sizeof(MoveListMiscellaneous)) != 0)
+		return false;
+
+	uint32_t captureIndex = 0;
+	for (uint32_t moveIndex = 0; moveIndex < allMoves->GetNumMoves(); moveIndex++)
+	{
+		const Move& move = (*allMoves)[moveIndex];
+		if (!move.IsCapture() && !move.IsPromotion())
+			continue;
+		if (captureIndex >= captures->GetNumMoves() || (*captures)[captureIndex] != move)
+			return false;
+		captureIndex++;
+	}
+	if (captureIndex != captures->GetNumMoves())
+		return false;
+
+	if (remainingDepth == 0)
+		return true;
+
+	for (uint32_t moveIndex = 0; moveIndex < allMoves->GetNumMoves(); moveIndex++)
+	{
+		Position newPosition;
+		Position::MakeMove<sideToMove>(position, newPosition, (*allMoves)[moveIndex]);
+		if (!CheckCaptureGeneration<oppositeSide>(newPosition, remainingDepth - 1))
+			return false;
+	}
+
+	return true;
+}
+
+inline bool TestCaptureGeneration()
+{
+	constexpr size_t depth = 2;
+
+	std::cout << "Running capture generation test\n";
+
+	std::string previousFen;
+	for (const auto& testPosition : ParsePerftTestSuite("./test/perftsuite.epd"))
+	{
+		if (testPosition.Fen == previousFen)
+			continue;
+		previousFen = testPosition.Fen;
+
+		const Position position = Position::ParseFen(testPosition.Fen);
+		const bool passed = position.SideToMove == WHITE ?
+			CheckCaptureGeneration<WHITE>(position, depth) :
+			CheckCaptureGeneration<BLACK>(position, depth);
+
+		if (!passed)
+		{
+			std::cout << "Capture generation test failed on " << testPosition.Fen << std::endl;
+			return false;
+		}
+	}
+
+	std::cout << "Capture generation test passed" << std::endl;
+	return true;
+}
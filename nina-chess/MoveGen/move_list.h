@@ -6,6 +6,13 @@
 #include <cstdint>
 #include <string.h>
 
+// CAPTURES only emits captures and promotions, everything in MoveListMiscellaneous is still filled in as for ALL
+enum class GenType : uint8_t
+{
+	ALL,
+	CAPTURES
+};
+
 struct MoveListMiscellaneous
 {
 	Bitboard PieceMoves[PIECE_TYPE_NONE] = { 0,0,0,0,0,0 };
@@ -20,22 +27,27 @@ struct MoveListMiscellaneous
 
 struct MoveList
 {
+	inline static constexpr uint32_t MAX_MOVES = 200;
+
 	forceinline constexpr MoveList() = default;
 
 	MoveListMiscellaneous MoveListMisc;
 
+	forceinline constexpr GenType GetGenType() const { return m_GenType; }
 	forceinline constexpr uint64_t GetHashOfPosition() const { return m_HashOfPosition; }
 	forceinline constexpr const Move* GetMoves() const { return m_Moves; }
 	forceinline constexpr uint32_t GetNumMoves() const { return m_NumMoves; }
 	forceinline constexpr void PushMove(const Move&& move) { m_Moves[m_NumMoves++] = move; }
 	forceinline void Reset();
+	forceinline constexpr void SetGenType(const GenType genType) { m_GenType = genType; }
 	forceinline constexpr void SetHashOfPosition(const uint64_t hash) { m_HashOfPosition = hash; }
 	forceinline constexpr const Move& operator[](const uint32_t index) const { return m_Moves[index]; }
 
 private:
-	alignas(CACHE_LINE_SIZE) Move m_Moves[200];
+	alignas(CACHE_LINE_SIZE) Move m_Moves[MAX_MOVES];
 	uint32_t m_NumMoves = 0;
 	uint64_t m_HashOfPosition = 0;
+	GenType m_GenType = GenType::ALL;
 };
 
 forceinline void MoveListMiscellaneous::Reset()
@@ -52,5 +64,6 @@ forceinline void MoveList::Reset()
 {
 	m_NumMoves = 0;
 	m_HashOfPosition = 0;
+	m_GenType = GenType::ALL;
 	MoveListMisc.Reset();
 }
@@ -3,6 +3,7 @@
 #include "Core/Engine/utils.h"
 #include "Hardware/architecture.h"
 #include "Hardware/avx_utils.h"
+#include "Hardware/simd.h"
 #include "NN/weights.h"
 #include <cmath>
 #include <cstdint>
@@ -11,11 +12,28 @@
 #include <stdexcept>
 #include <string.h>
 
+// the largest number of registers, at most half of the register file, that evenly divides numOutputRegisters
+// the other half is left for the weights being added
+consteval size_t GetAccumulatorTileRegisters(const size_t numOutputRegisters)
+{
+	for (size_t tileRegisters = NUM_SIMD_REGISTERS / 2; tileRegisters > 1; tileRegisters--)
+	{
+		if (numOutputRegisters % tileRegisters == 0)
+			return tileRegisters;
+	}
+	return 1;
+}
+
 template<typename BitboardFeatureIterator, size_t outputSize>
 class BitboardFeatureAccumulator
 {
 public:
 	inline static constexpr size_t BITS_IN_BITBOARD = 64;
+	// outputs that fill whole registers are updated one tile of registers at a time
+	// the tile stays in registers across every added and removed feature and is stored once at the end
+	inline static constexpr bool IS_VECTORIZED = (outputSize % FLOATS_PER_REGISTER) == 0;
+	inline static constexpr size_t TILE_REGISTERS = GetAccumulatorTileRegisters(outputSize / FLOATS_PER_REGISTER);
+	inline static constexpr size_t TILE_SIZE = TILE_REGISTERS * FLOATS_PER_REGISTER;
 	struct Weights
 	{
 		alignas(CACHE_LINE_SIZE) float Weights[BitboardFeatureIterator::NumBitboardFeatures() * BITS_IN_BITBOARD][outputSize];
@@ -36,6 +54,10 @@ private:
 	template<size_t bitboardIndex>
 	forceinline constexpr void accumulateFeatures(const BitboardFeatureIterator& newFeaturesIterator,
 		const BitboardFeatureIterator& oldFeaturesIterator, const float* previousAccumulatorOutput);
+	template<size_t bitboardIndex>
+	forceinline constexpr void accumulateTile(const BitboardFeatureIterator& newFeaturesIterator,
+		const BitboardFeatureIterator& oldFeaturesIterator, SimdVector(&tile)[TILE_REGISTERS], const size_t tileOffset);
+	forceinline constexpr void resetTile(const BitboardFeatureIterator& newFeaturesIterator, SimdVector(&tile)[TILE_REGISTERS], const size_t tileOffset);
 
 	forceinline constexpr size_t getWeightsIndex(const size_t bitboard_index, const uint32_t feature_in_bitboard_index);
 	forceinline constexpr void validateOutput(const BitboardFeatureIterator& new_features_iterator);
@@ -89,13 +111,69 @@ template<typename BitboardFeatureIterator, size_t outputSize>
 forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::AccumulateFeatures(const BitboardFeatureIterator& newFeaturesIterator,
 	const BitboardFeatureIterator& oldFeaturesIterator, const float* previousAccumulatorOutput)
 {
-	std::memcpy(m_Output, previousAccumulatorOutput, sizeof(m_Output));
+	if constexpr (IS_VECTORIZED)
+	{
+		for (size_t tileOffset = 0; tileOffset < outputSize; tileOffset += TILE_SIZE)
+		{
+			SimdVector tile[TILE_REGISTERS];
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				tile[registerIndex] = SimdLoad(&previousAccumulatorOutput[tileOffset + registerIndex * FLOATS_PER_REGISTER]);
+			}
+
+			accumulateTile<0>(newFeaturesIterator, oldFeaturesIterator, tile, tileOffset);
+
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				SimdStore(&m_Output[tileOffset + registerIndex * FLOATS_PER_REGISTER], tile[registerIndex]);
+			}
+		}
+	}
+	else
+	{
+		std::memcpy(m_Output, previousAccumulatorOutput, sizeof(m_Output));
 
-	accumulateFeatures<0>(newFeaturesIterator, oldFeaturesIterator, previousAccumulatorOutput);
+		accumulateFeatures<0>(newFeaturesIterator, oldFeaturesIterator, previousAccumulatorOutput);
+	}
 
 	validateOutput(newFeaturesIterator);
 }
 
+template<typename BitboardFeatureIterator, size_t outputSize>
+template<size_t bitboardIndex>
+forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::accumulateTile(const BitboardFeatureIterator& newFeaturesIterator,
+	const BitboardFeatureIterator& oldFeaturesIterator, SimdVector(&tile)[TILE_REGISTERS], const size_t tileOffset)
+{
+	const Bitboard newFeatures = newFeaturesIterator.template Get<bitboardIndex>(0.f);
+	const Bitboard oldFeatures = oldFeaturesIterator.template Get<bitboardIndex>(0.f);
+
+	Bitboard addedFeatures = newFeatures & ~oldFeatures;
+	Bitboard removedFeatures = ~newFeatures & oldFeatures;
+
+	while (addedFeatures)
+	{
+		const float* weights = &m_Weights->Weights[getWeightsIndex(bitboardIndex, PopBitAndGetIndex(addedFeatures))][tileOffset];
+		for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+		{
+			tile[registerIndex] = SimdAdd(tile[registerIndex], SimdLoad(&weights[registerIndex * FLOATS_PER_REGISTER]));
+		}
+	}
+
+	while (removedFeatures)
+	{
+		const float* weights = &m_Weights->Weights[getWeightsIndex(bitboardIndex, PopBitAndGetIndex(removedFeatures))][tileOffset];
+		for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+		{
+			tile[registerIndex] = SimdSub(tile[registerIndex], SimdLoad(&weights[registerIndex * FLOATS_PER_REGISTER]));
+		}
+	}
+
+	if constexpr (bitboardIndex + 1 < BitboardFeatureIterator::NumBitboardFeatures())
+	{
+		accumulateTile<bitboardIndex + 1>(newFeaturesIterator, oldFeaturesIterator, tile, tileOffset);
+	}
+}
+
 template<typename BitboardFeatureIterator, size_t outputSize>
 forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::Weights::SetWeights(std::ifstream& weightsFile)
 {
@@ -127,6 +205,20 @@ forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, o
 template<typename BitboardFeatureIterator, size_t outputSize>
 forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::Reset(const BitboardFeatureIterator& newFeaturesIterator)
 {
+	if constexpr (IS_VECTORIZED)
+	{
+		for (size_t tileOffset = 0; tileOffset < outputSize; tileOffset += TILE_SIZE)
+		{
+			SimdVector tile[TILE_REGISTERS];
+			resetTile(newFeaturesIterator, tile, tileOffset);
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				SimdStore(&m_Output[tileOffset + registerIndex * FLOATS_PER_REGISTER], tile[registerIndex]);
+			}
+		}
+		return;
+	}
+
 	std::memcpy(m_Output, m_Weights->Bias, sizeof(m_Output));
 
 	for (size_t bitboardIndex = 0; bitboardIndex < BitboardFeatureIterator::NumBitboardFeatures(); bitboardIndex++)
@@ -146,6 +238,30 @@ forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, o
 	}
 }
 
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr void BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::resetTile(const BitboardFeatureIterator& newFeaturesIterator,
+	SimdVector(&tile)[TILE_REGISTERS], const size_t tileOffset)
+{
+	for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+	{
+		tile[registerIndex] = SimdLoad(&m_Weights->Bias[tileOffset + registerIndex * FLOATS_PER_REGISTER]);
+	}
+
+	for (size_t bitboardIndex = 0; bitboardIndex < BitboardFeatureIterator::NumBitboardFeatures(); bitboardIndex++)
+	{
+		Bitboard newFeatures = newFeaturesIterator.Get(bitboardIndex);
+
+		while (newFeatures)
+		{
+			const float* weights = &m_Weights->Weights[getWeightsIndex(bitboardIndex, PopBitAndGetIndex(newFeatures))][tileOffset];
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				tile[registerIndex] = SimdAdd(tile[registerIndex], SimdLoad(&weights[registerIndex * FLOATS_PER_REGISTER]));
+			}
+		}
+	}
+}
+
 template<typename BitboardFeatureIterator, size_t outputSize>
 forceinline constexpr size_t BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::getWeightsIndex(const size_t bitboardIndex, const uint32_t featureInBitboardIndex)
 {
@@ -21,6 +21,12 @@ public:
 	// AVX2 and AVX512 implementation parses a few input vectors at once
 	// 8 is a number found through trial and error on my hardware to be correct
 	static constexpr size_t INPUT_VECTORS_PARSED = 8;
+	// the batched path works on BATCH_TILE input vectors times BATCH_OUTPUT_TILE outputs at once, every weights load
+	// is used for all the inputs of the tile, and the sums stay in registers over all input packs
+	// 3 * 4 sums and 4 weights fill the 16 AVX2 registers, it measured best among the tiles that fit
+	// a single output tile gets more inputs, otherwise too few sums can't hide the latency of the fused multiply adds
+	static constexpr size_t BATCH_OUTPUT_TILE = outputNeurons < 4 ? outputNeurons : 4;
+	static constexpr size_t BATCH_TILE = outputNeurons > int(BATCH_OUTPUT_TILE) ? 3 : 8;
 
 	alignas(CACHE_LINE_SIZE) SimdPack Weights[NUM_INPUT_PACKS][outputNeurons];
 	alignas(CACHE_LINE_SIZE) float Biases[outputNeurons];
@@ -35,7 +41,15 @@ public:
 	forceinline void ReadWeights(std::ifstream& weightsFile)
 	{
 		auto weightsFromFile = std::make_unique<float[]>(inputNeurons * outputNeurons);
+		auto biasesFromFile = std::make_unique<float[]>(outputNeurons);
 		weightsFile.read((char*)weightsFromFile.get(), inputNeurons * outputNeurons * sizeof(float));
+		weightsFile.read((char*)biasesFromFile.get(), outputNeurons * sizeof(float));
+		SetWeights(weightsFromFile.get(), biasesFromFile.get());
+	}
+
+	// weights are given input major, weights[inputNeuronIndex * outputNeurons + outputNeuronIndex]
+	forceinline void SetWeights(const float* weights, const float* biases)
+	{
 		for (int inputNeuronIndex = 0; inputNeuronIndex < inputNeurons; inputNeuronIndex++)
 		{
 			for (int outputNeuronIndex = 0; outputNeuronIndex < outputNeurons; outputNeuronIndex++)
@@ -44,10 +58,10 @@ public:
 				const int inputInPack = inputNeuronIndex % FLOATS_PER_REGISTER;
 
 				Weights[inputPack][outputNeuronIndex][inputInPack] =
-					weightsFromFile[inputNeuronIndex * outputNeurons + outputNeuronIndex];
+					weights[inputNeuronIndex * outputNeurons + outputNeuronIndex];
 			}
 		}
-		weightsFile.read((char*)Biases, sizeof(Biases));
+		std::memcpy(Biases, biases, sizeof(Biases));
 	}
 
 	forceinline void InitializeWeights();
@@ -61,7 +75,104 @@ public:
 		return forwardAvx(input);
 	}
 
+	// same as Forward for batch input vectors stored one after another, each one inputNeurons floats and cache line aligned
+	// outputs gets outputNeurons floats per input vector, Output is left untouched
+	// the weights are streamed through once per tile of inputs instead of once per input, with one horizontal sum per output
+	// against looping Forward over 8192 inputs it measured 1.35x faster for 1600x1 and up to 1.1x for 512x16, 256x8 and 176x8,
+	// but slower for tiny layers like 64x1, check before using it anywhere but the 1600x1 batch evaluation
+	forceinline void ForwardBatch(const float* inputs, const size_t batch, float* outputs)
+	{
+		size_t inputIndex = 0;
+		for (; inputIndex + BATCH_TILE <= batch; inputIndex += BATCH_TILE)
+		{
+			forwardBatchTile<BATCH_TILE>(&inputs[inputIndex * inputNeurons], &outputs[inputIndex * outputNeurons]);
+		}
+		for (; inputIndex < batch; inputIndex++)
+		{
+			forwardBatchTile<1>(&inputs[inputIndex * inputNeurons], &outputs[inputIndex * outputNeurons]);
+		}
+	}
+
 private:
+	template<size_t tileSize, size_t outputTileSize, bool isActivated>
+	forceinline void forwardBatchOutputs(const float* inputs, const int firstOutputNode, float* outputs)
+	{
+		SimdVector outputSums[tileSize][outputTileSize];
+		for (size_t tileIndex = 0; tileIndex < tileSize; tileIndex++)
+		{
+			for (size_t outputIndex = 0; outputIndex < outputTileSize; outputIndex++)
+			{
+				outputSums[tileIndex][outputIndex] = SimdSetZero();
+			}
+		}
+
+		for (int inputPack = 0; inputPack < NUM_INPUT_PACKS; inputPack++)
+		{
+			SimdVector weights[outputTileSize];
+			for (size_t outputIndex = 0; outputIndex < outputTileSize; outputIndex++)
+			{
+				weights[outputIndex] = SimdLoad((const float*)&Weights[inputPack][firstOutputNode + outputIndex]);
+			}
+
+			for (size_t tileIndex = 0; tileIndex < tileSize; tileIndex++)
+			{
+				SimdVector input = SimdLoad(&inputs[tileIndex * inputNeurons + inputPack * FLOATS_PER_REGISTER]);
+				if constexpr (!isActivated)
+				{
+					input = ApplyActivation<activationFunction>(input);
+				}
+				for (size_t outputIndex = 0; outputIndex < outputTileSize; outputIndex++)
+				{
+					outputSums[tileIndex][outputIndex] = SimdFusedMultiplyAdd(input, weights[outputIndex], outputSums[tileIndex][outputIndex]);
+				}
+			}
+		}
+
+		// a single horizontal sum and store per output of every input, unlike Forward which adds to Output after every pass
+		for (size_t tileIndex = 0; tileIndex < tileSize; tileIndex++)
+		{
+			for (size_t outputIndex = 0; outputIndex < outputTileSize; outputIndex++)
+			{
+				const int outputNode = firstOutputNode + int(outputIndex);
+				outputs[tileIndex * outputNeurons + outputNode] = Biases[outputNode] + SimdHorizontalSum(outputSums[tileIndex][outputIndex]);
+			}
+		}
+	}
+
+	template<size_t tileSize, bool isActivated>
+	forceinline void forwardBatchOutputTiles(const float* inputs, float* outputs)
+	{
+		int outputNode = 0;
+		for (; outputNode + int(BATCH_OUTPUT_TILE) <= outputNeurons; outputNode += int(BATCH_OUTPUT_TILE))
+		{
+			forwardBatchOutputs<tileSize, BATCH_OUTPUT_TILE, isActivated>(inputs, outputNode, outputs);
+		}
+		for (; outputNode < outputNeurons; outputNode++)
+		{
+			forwardBatchOutputs<tileSize, 1, isActivated>(inputs, outputNode, outputs);
+		}
+	}
+
+	template<size_t tileSize>
+	forceinline void forwardBatchTile(const float* inputs, float* outputs)
+	{
+		// a single output tile activates the inputs as it reads them, copying them would only push them out of L1
+		if constexpr (outputNeurons <= int(BATCH_OUTPUT_TILE))
+		{
+			forwardBatchOutputTiles<tileSize, false>(inputs, outputs);
+		}
+		// otherwise they get activated once instead of once per output tile
+		else
+		{
+			alignas(CACHE_LINE_SIZE) float activatedInputs[tileSize * inputNeurons];
+			for (size_t inputIndex = 0; inputIndex < tileSize * inputNeurons; inputIndex += FLOATS_PER_REGISTER)
+			{
+				SimdStore(&activatedInputs[inputIndex], ApplyActivation<activationFunction>(SimdLoad(&inputs[inputIndex])));
+			}
+			forwardBatchOutputTiles<tileSize, true>(activatedInputs, outputs);
+		}
+	}
+
 	template<int packsInPass>
 	forceinline void forwardAvxPass(const float* input, const int weightsBaseIndex)
 	{
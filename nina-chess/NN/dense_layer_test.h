@@ -77,6 +77,33 @@ bool TestDenseLayerShape(const char* name)
 		}
 	}
 
+	// batched forward pass, enough inputs for a full tile and a remainder, each must match the single input pass
+	constexpr size_t BATCH = 2 * DenseLayer<inputNeurons, outputNeurons, activationFunction>::BATCH_TILE + 3;
+	alignas(CACHE_LINE_SIZE) static float batchInputs[BATCH][inputNeurons];
+	float batchOutputs[BATCH][outputNeurons];
+	for (size_t batchIndex = 0; batchIndex < BATCH; batchIndex++)
+		for (int inputIndex = 0; inputIndex < inputNeurons; inputIndex++)
+			batchInputs[batchIndex][inputIndex] = inputDist(prng);
+
+	layer.ForwardBatch(&batchInputs[0][0], BATCH, &batchOutputs[0][0]);
+
+	for (size_t batchIndex = 0; batchIndex < BATCH; batchIndex++)
+	{
+		const float* singleOutput = layer.Forward(batchInputs[batchIndex]);
+		for (int outputIndex = 0; outputIndex < outputNeurons; outputIndex++)
+		{
+			const float delta = std::abs(batchOutputs[batchIndex][outputIndex] - singleOutput[outputIndex]);
+			if (delta >= EPSILON)
+			{
+				std::cout << "  FAIL " << name << " batch[" << batchIndex << "] output[" << outputIndex << "]: "
+					<< "batch=" << batchOutputs[batchIndex][outputIndex]
+					<< " single=" << singleOutput[outputIndex]
+					<< " delta=" << delta << "\n";
+				passed = false;
+			}
+		}
+	}
+
 	if (passed)
 		std::cout << "  PASS " << name << "\n";
 
@@ -95,6 +122,8 @@ inline bool TestDenseLayer()
 	allPassed &= TestDenseLayerShape<256, 1, ActivationFunction::TANH>("DenseLayer<256,1,TANH>");
 	allPassed &= TestDenseLayerShape<512, 16, ActivationFunction::RELU>("DenseLayer<512,16,RELU>");
 	allPassed &= TestDenseLayerShape<176, 8, ActivationFunction::RELU>("DenseLayer<176,8,RELU>");
+	// not a multiple of the batched output tile, the last outputs go one at a time
+	allPassed &= TestDenseLayerShape<48, 6, ActivationFunction::RELU>("DenseLayer<48,6,RELU>");
 
 	if (!allPassed)
 		std::cout << "DenseLayer test FAILED\n";
@@ -0,0 +1,23 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// fixed point scales shared by the quantized accumulator and dense layers
+// an activation of 1.0 is QUANTIZED_ACTIVATION_SCALE, it stays below 128 so that the int16 pair sums of maddubs cannot saturate
+inline constexpr int32_t QUANTIZED_ACTIVATION_SCALE = 127;
+// int8 dense layer weights are in [-127/64, 127/64]
+inline constexpr int32_t QUANTIZED_WEIGHT_SCALE = 64;
+
+// rounds value * scale to the nearest integer and clamps it into the range of T
+template<typename T>
+forceinline T Quantize(const float value, const int32_t scale)
+{
+	// double so that the int32 limits are exact
+	constexpr double MIN_VALUE = static_cast<double>(std::numeric_limits<T>::min());
+	constexpr double MAX_VALUE = static_cast<double>(std::numeric_limits<T>::max());
+
+	const double scaled = std::round(static_cast<double>(value) * scale);
+	return static_cast<T>(scaled < MIN_VALUE ? MIN_VALUE : (scaled > MAX_VALUE ? MAX_VALUE : scaled));
+}
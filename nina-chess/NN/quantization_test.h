@@ -0,0 +1,266 @@
+#pragma once
+
+#include "Chess/board_features.h"
+#include "Chess/color.h"
+#include "Chess/position.h"
+#include "Core/Engine/bit_manip.h"
+#include "Core/Engine/rng.h"
+#include "Eval/chess_bitboard_feature_iterator.h"
+#include "Hardware/architecture.h"
+#include "Hardware/intrinsics.h"
+#include "MoveGen/move_gen.h"
+#include "MoveGen/move_list.h"
+#include "NN/accumulator.h"
+#include "NN/dense_layer.h"
+#include "NN/quantization.h"
+#include "NN/quantized_accumulator.h"
+#include "NN/quantized_dense_layer.h"
+#include "Search/perft.h"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+// the quantized layer is checked twice: exactly against a scalar integer dot product, which tests the simd kernels,
+// and against the float DenseLayer given the same float weights, within the worst case error of rounding every weight
+template<int inputNeurons, int outputNeurons>
+bool TestQuantizedDenseLayerShape(const char* name)
+{
+	constexpr float EPSILON = 1e-4f;
+	using FloatLayer = DenseLayer<inputNeurons, outputNeurons, ActivationFunction::RELU>;
+	using QuantizedLayer = QuantizedDenseLayer<inputNeurons, outputNeurons>;
+
+	Xorshift64 prng(0xF00D);
+	std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+	std::uniform_int_distribution<int> inputDist(0, QUANTIZED_ACTIVATION_SCALE);
+
+	auto weights = std::make_unique<float[]>(inputNeurons * outputNeurons);
+	float biases[outputNeurons];
+	for (int weightIndex = 0; weightIndex < inputNeurons * outputNeurons; weightIndex++)
+		weights[weightIndex] = weightDist(prng);
+	for (int outputIndex = 0; outputIndex < outputNeurons; outputIndex++)
+		biases[outputIndex] = weightDist(prng);
+
+	auto floatLayer = std::make_unique<FloatLayer>();
+	auto quantizedLayer = std::make_unique<QuantizedLayer>();
+	floatLayer->SetWeights(weights.get(), biases);
+	quantizedLayer->SetWeights(weights.get(), biases);
+
+	alignas(CACHE_LINE_SIZE) uint8_t quantizedInput[inputNeurons];
+	alignas(CACHE_LINE_SIZE) float floatInput[inputNeurons];
+	float inputSum = 0;
+	for (int inputIndex = 0; inputIndex < inputNeurons; inputIndex++)
+	{
+		quantizedInput[inputIndex] = static_cast<uint8_t>(inputDist(prng));
+		floatInput[inputIndex] = static_cast<float>(quantizedInput[inputIndex]) / QUANTIZED_ACTIVATION_SCALE;
+		inputSum += floatInput[inputIndex];
+	}
+
+	const int32_t* quantizedOutput = quantizedLayer->Forward(quantizedInput);
+	const float* floatOutput = floatLayer->Forward(floatInput);
+
+	// every weight is off by at most half a step, the bias by half an output step
+	const float tolerance = inputSum * 0.5f / QUANTIZED_WEIGHT_SCALE + 0.5f / QuantizedLayer::OUTPUT_SCALE + EPSILON;
+
+	bool passed = true;
+	for (int outputIndex = 0; outputIndex < outputNeurons; outputIndex++)
+	{
+		int32_t scalarOutput = quantizedLayer->Biases[outputIndex];
+		for (int inputIndex = 0; inputIndex < inputNeurons; inputIndex++)
+			scalarOutput += int32_t(quantizedInput[inputIndex]) * quantizedLayer->Weights[outputIndex][inputIndex];
+
+		if (quantizedOutput[outputIndex] != scalarOutput)
+		{
+			std::cout << "  FAIL " << name << " output[" << outputIndex << "]: "
+				<< "simd=" << quantizedOutput[outputIndex]
+				<< " scalar=" << scalarOutput << "\n";
+			passed = false;
+		}
+
+		const float delta = std::abs(QuantizedLayer::Dequantize(quantizedOutput[outputIndex]) - floatOutput[outputIndex]);
+		if (delta > tolerance)
+		{
+			std::cout << "  FAIL " << name << " output[" << outputIndex << "]: "
+				<< "quantized=" << QuantizedLayer::Dequantize(quantizedOutput[outputIndex])
+				<< " float=" << floatOutput[outputIndex]
+				<< " delta=" << delta << " tolerance=" << tolerance << "\n";
+			passed = false;
+		}
+	}
+
+	if (passed)
+		std::cout << "  PASS " << name << "\n";
+
+	return passed;
+}
+
+template<size_t outputSize>
+struct AccumulatorPair
+{
+	using FloatAccumulator = BitboardFeatureAccumulator<ChessBitboardFeatureIterator, outputSize>;
+	using QuantizedAccumulator = QuantizedBitboardFeatureAccumulator<ChessBitboardFeatureIterator, outputSize>;
+
+	typename FloatAccumulator::Weights FloatWeights;
+	typename QuantizedAccumulator::Weights QuantizedWeights;
+	FloatAccumulator Float[2];
+	QuantizedAccumulator Quantized[2];
+};
+
+template<size_t outputSize>
+bool CompareAccumulators(const AccumulatorPair<outputSize>& accumulators, const size_t index, const ChessBitboardFeatureIterator& featuresIterator)
+{
+	constexpr float EPSILON = 1e-3f;
+
+	// plain scalar sums of the active features, the references for both simd accumulators
+	float floatReference[outputSize];
+	int32_t quantizedReference[outputSize];
+	for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+	{
+		floatReference[outputIndex] = accumulators.FloatWeights.Bias[outputIndex];
+		quantizedReference[outputIndex] = accumulators.QuantizedWeights.Bias[outputIndex];
+	}
+
+	uint32_t activeFeatures = 0;
+	for (size_t bitboardIndex = 0; bitboardIndex < ChessBitboardFeatureIterator::NumBitboardFeatures(); bitboardIndex++)
+	{
+		Bitboard features = featuresIterator.Get(bitboardIndex);
+		activeFeatures += Popcnt(features);
+		while (features)
+		{
+			const size_t weightsIndex = bitboardIndex * 64 + PopBitAndGetIndex(features);
+			for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+			{
+				floatReference[outputIndex] += accumulators.FloatWeights.Weights[weightsIndex][outputIndex];
+				quantizedReference[outputIndex] += accumulators.QuantizedWeights.Weights[weightsIndex][outputIndex];
+			}
+		}
+	}
+
+	// every active weight and the bias are off by at most half a step
+	const float tolerance = (activeFeatures + 1) * 0.5f / QUANTIZED_ACTIVATION_SCALE + EPSILON;
+
+	for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+	{
+		const int16_t quantizedValue = accumulators.Quantized[index].GetOutput()[outputIndex];
+		const float quantizedOutput = static_cast<float>(quantizedValue) / QUANTIZED_ACTIVATION_SCALE;
+		const float floatOutput = accumulators.Float[index].GetOutput()[outputIndex];
+		if (quantizedValue != quantizedReference[outputIndex] || std::abs(floatOutput - floatReference[outputIndex]) > EPSILON)
+		{
+			std::cout << "  FAIL accumulator output[" << outputIndex << "]: "
+				<< "quantized=" << quantizedValue << " reference=" << quantizedReference[outputIndex]
+				<< " float=" << floatOutput << " reference=" << floatReference[outputIndex] << "\n";
+			return false;
+		}
+		if (std::abs(quantizedOutput - floatOutput) > tolerance)
+		{
+			std::cout << "  FAIL accumulator output[" << outputIndex << "]: "
+				<< "quantized=" << quantizedOutput
+				<< " float=" << floatOutput
+				<< " tolerance=" << tolerance << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+// resets both accumulators on the position and updates them incrementally into every child
+template<Color sideToMove, size_t outputSize>
+bool CheckQuantizedAccumulator(AccumulatorPair<outputSize>& accumulators, const Position& position)
+{
+	constexpr Color oppositeSide = GetOppositeColor<sideToMove>();
+
+	std::unique_ptr<MoveList> moveList = std::make_unique<MoveList>();
+	std::unique_ptr<MoveList> childMoveList = std::make_unique<MoveList>();
+	GenerateMoves<sideToMove>(position, *moveList);
+
+	const BoardFeatures rootFeatures{ &position.WhitePieces, &position.BlackPieces, position.EnPassantSquare, position.CastlingPermissions };
+	const ChessBitboardFeatureIterator rootIterator(rootFeatures, moveList->MoveListMisc);
+	accumulators.Float[0].Reset(rootIterator);
+	accumulators.Quantized[0].Reset(rootIterator);
+	if (!CompareAccumulators(accumulators, 0, rootIterator))
+		return false;
+
+	for (uint32_t moveIndex = 0; moveIndex < moveList->GetNumMoves(); moveIndex++)
+	{
+		Position child;
+		Position::MakeMove<sideToMove>(position, child, (*moveList)[moveIndex]);
+		childMoveList->Reset();
+		GenerateMoves<oppositeSide>(child, *childMoveList);
+
+		const BoardFeatures childFeatures{ &child.WhitePieces, &child.BlackPieces, child.EnPassantSquare, child.CastlingPermissions };
+		const ChessBitboardFeatureIterator childIterator(childFeatures, childMoveList->MoveListMisc);
+		accumulators.Float[1].AccumulateFeatures(childIterator, rootIterator, accumulators.Float[0].GetOutput());
+		accumulators.Quantized[1].AccumulateFeatures(childIterator, rootIterator, accumulators.Quantized[0].GetOutput());
+		if (!CompareAccumulators(accumulators, 1, childIterator))
+			return false;
+	}
+	return true;
+}
+
+inline bool TestQuantizedAccumulator()
+{
+	// several tiles of registers on every architecture
+	constexpr size_t OUTPUT_SIZE = 256;
+	constexpr size_t NUM_WEIGHTS = ChessBitboardFeatureIterator::NumBitboardFeatures() * 64;
+
+	auto accumulators = std::make_unique<AccumulatorPair<OUTPUT_SIZE>>();
+
+	Xorshift64 prng(0xACC);
+	std::uniform_real_distribution<float> weightDist(-0.5f, 0.5f);
+	for (size_t weightsIndex = 0; weightsIndex < NUM_WEIGHTS; weightsIndex++)
+		for (size_t outputIndex = 0; outputIndex < OUTPUT_SIZE; outputIndex++)
+			accumulators->FloatWeights.Weights[weightsIndex][outputIndex] = weightDist(prng);
+	for (size_t outputIndex = 0; outputIndex < OUTPUT_SIZE; outputIndex++)
+		accumulators->FloatWeights.Bias[outputIndex] = weightDist(prng);
+
+	accumulators->QuantizedWeights.Quantize(accumulators->FloatWeights);
+	for (size_t index = 0; index < 2; index++)
+	{
+		accumulators->Float[index].SetWeights(accumulators->FloatWeights);
+		accumulators->Quantized[index].SetWeights(accumulators->QuantizedWeights);
+	}
+
+	std::string previousFen;
+	for (const auto& testPosition : ParsePerftTestSuite("./test/perftsuite.epd"))
+	{
+		if (testPosition.Fen == previousFen)
+			continue;
+		previousFen = testPosition.Fen;
+
+		const Position position = Position::ParseFen(testPosition.Fen);
+		const bool passed = position.SideToMove == WHITE ?
+			CheckQuantizedAccumulator<WHITE>(*accumulators, position) :
+			CheckQuantizedAccumulator<BLACK>(*accumulators, position);
+
+		if (!passed)
+		{
+			std::cout << "  FAIL accumulator on " << testPosition.Fen << "\n";
+			return false;
+		}
+	}
+
+	std::cout << "  PASS QuantizedBitboardFeatureAccumulator<256>\n";
+	return true;
+}
+
+inline bool TestQuantization()
+{
+	std::cout << "Running quantized vs float tests\n";
+
+	bool allPassed = true;
+	allPassed &= TestQuantizedDenseLayerShape<64, 8>("QuantizedDenseLayer<64,8>");
+	allPassed &= TestQuantizedDenseLayerShape<128, 1>("QuantizedDenseLayer<128,1>");
+	allPassed &= TestQuantizedDenseLayerShape<256, 16>("QuantizedDenseLayer<256,16>");
+	allPassed &= TestQuantizedDenseLayerShape<512, 32>("QuantizedDenseLayer<512,32>");
+	allPassed &= TestQuantizedDenseLayerShape<1024, 4>("QuantizedDenseLayer<1024,4>");
+	allPassed &= TestQuantizedAccumulator();
+
+	if (!allPassed)
+		std::cout << "Quantization test FAILED\n";
+	else
+		std::cout << "Quantization test passed\n";
+
+	return allPassed;
+}
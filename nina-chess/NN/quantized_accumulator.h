@@ -0,0 +1,284 @@
+#pragma once
+#include "Core/Engine/bit_manip.h"
+#include "Core/Engine/utils.h"
+#include "Hardware/architecture.h"
+#include "Hardware/simd.h"
+#include "NN/accumulator.h"
+#include "NN/quantization.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string.h>
+
+// int16 counterpart of BitboardFeatureAccumulator, the weights are the float ones times QUANTIZED_ACTIVATION_SCALE
+// integer sums are exact, so unlike the float accumulator an incremental update always matches a full reset
+template<typename BitboardFeatureIterator, size_t outputSize>
+class QuantizedBitboardFeatureAccumulator
+{
+public:
+	inline static constexpr size_t BITS_IN_BITBOARD = 64;
+	using FloatWeights = typename BitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::Weights;
+	// tiled the same way as the float accumulator
+	inline static constexpr bool IS_VECTORIZED = (outputSize % INT16_PER_REGISTER) == 0;
+	inline static constexpr size_t TILE_REGISTERS = GetAccumulatorTileRegisters(outputSize / INT16_PER_REGISTER);
+	inline static constexpr size_t TILE_SIZE = TILE_REGISTERS * INT16_PER_REGISTER;
+
+	struct Weights
+	{
+		alignas(CACHE_LINE_SIZE) int16_t Weights[BitboardFeatureIterator::NumBitboardFeatures() * BITS_IN_BITBOARD][outputSize];
+		alignas(CACHE_LINE_SIZE) int16_t Bias[outputSize];
+
+		forceinline void SetWeights(std::ifstream& weightsFile);
+		forceinline void Quantize(const FloatWeights& floatWeights);
+	};
+
+	QuantizedBitboardFeatureAccumulator() = default;
+
+	forceinline constexpr void AccumulateFeatures(const BitboardFeatureIterator& newFeaturesIterator,
+		const BitboardFeatureIterator& oldFeaturesIterator, const int16_t* previousAccumulatorOutput);
+	forceinline constexpr const int16_t* GetOutput() const { return m_Output; }
+	forceinline constexpr void Reset(const BitboardFeatureIterator& newFeaturesIterator);
+	forceinline constexpr void SetWeights(Weights& weightsToSet) { m_Weights = &weightsToSet; }
+	// clipped relu into the uint8 inputs of a QuantizedDenseLayer
+	forceinline constexpr void ClippedRelu(uint8_t* output) const;
+
+private:
+	template<size_t bitboardIndex>
+	forceinline constexpr void accumulateFeatures(const BitboardFeatureIterator& newFeaturesIterator,
+		const BitboardFeatureIterator& oldFeaturesIterator);
+	template<size_t bitboardIndex>
+	forceinline constexpr void accumulateTile(const BitboardFeatureIterator& newFeaturesIterator,
+		const BitboardFeatureIterator& oldFeaturesIterator, SimdIntVector(&tile)[TILE_REGISTERS], const size_t tileOffset);
+	forceinline constexpr void resetTile(const BitboardFeatureIterator& newFeaturesIterator, SimdIntVector(&tile)[TILE_REGISTERS], const size_t tileOffset);
+
+	forceinline constexpr size_t getWeightsIndex(const size_t bitboardIndex, const uint32_t featureInBitboardIndex);
+	forceinline constexpr void validateOutput(const BitboardFeatureIterator& newFeaturesIterator);
+
+	const Weights* m_Weights;
+	alignas(CACHE_LINE_SIZE) int16_t m_Output[outputSize];
+};
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+template<size_t bitboardIndex>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::accumulateFeatures(const BitboardFeatureIterator& newFeaturesIterator,
+	const BitboardFeatureIterator& oldFeaturesIterator)
+{
+	const Bitboard newFeatures = newFeaturesIterator.template Get<bitboardIndex>(0.f);
+	const Bitboard oldFeatures = oldFeaturesIterator.template Get<bitboardIndex>(0.f);
+
+	Bitboard addedFeatures = newFeatures & ~oldFeatures;
+	Bitboard removedFeatures = ~newFeatures & oldFeatures;
+
+	while (addedFeatures)
+	{
+		const uint32_t featureIndex = PopBitAndGetIndex(addedFeatures);
+		const size_t weightsIndex = getWeightsIndex(bitboardIndex, featureIndex);
+
+		for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+		{
+			m_Output[outputIndex] += m_Weights->Weights[weightsIndex][outputIndex];
+		}
+	}
+
+	while (removedFeatures)
+	{
+		const uint32_t featureIndex = PopBitAndGetIndex(removedFeatures);
+		const size_t weightsIndex = getWeightsIndex(bitboardIndex, featureIndex);
+
+		for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+		{
+			m_Output[outputIndex] -= m_Weights->Weights[weightsIndex][outputIndex];
+		}
+	}
+
+	if constexpr (bitboardIndex + 1 < BitboardFeatureIterator::NumBitboardFeatures())
+	{
+		accumulateFeatures<bitboardIndex + 1>(newFeaturesIterator, oldFeaturesIterator);
+	}
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::AccumulateFeatures(const BitboardFeatureIterator& newFeaturesIterator,
+	const BitboardFeatureIterator& oldFeaturesIterator, const int16_t* previousAccumulatorOutput)
+{
+	if constexpr (IS_VECTORIZED)
+	{
+		for (size_t tileOffset = 0; tileOffset < outputSize; tileOffset += TILE_SIZE)
+		{
+			SimdIntVector tile[TILE_REGISTERS];
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				tile[registerIndex] = SimdIntLoad(&previousAccumulatorOutput[tileOffset + registerIndex * INT16_PER_REGISTER]);
+			}
+
+			accumulateTile<0>(newFeaturesIterator, oldFeaturesIterator, tile, tileOffset);
+
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				SimdIntStore(&m_Output[tileOffset + registerIndex * INT16_PER_REGISTER], tile[registerIndex]);
+			}
+		}
+	}
+	else
+	{
+		std::memcpy(m_Output, previousAccumulatorOutput, sizeof(m_Output));
+
+		accumulateFeatures<0>(newFeaturesIterator, oldFeaturesIterator);
+	}
+
+	validateOutput(newFeaturesIterator);
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+template<size_t bitboardIndex>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::accumulateTile(const BitboardFeatureIterator& newFeaturesIterator,
+	const BitboardFeatureIterator& oldFeaturesIterator, SimdIntVector(&tile)[TILE_REGISTERS], const size_t tileOffset)
+{
+	const Bitboard newFeatures = newFeaturesIterator.template Get<bitboardIndex>(0.f);
+	const Bitboard oldFeatures = oldFeaturesIterator.template Get<bitboardIndex>(0.f);
+
+	Bitboard addedFeatures = newFeatures & ~oldFeatures;
+	Bitboard removedFeatures = ~newFeatures & oldFeatures;
+
+	while (addedFeatures)
+	{
+		const int16_t* weights = &m_Weights->Weights[getWeightsIndex(bitboardIndex, PopBitAndGetIndex(addedFeatures))][tileOffset];
+		for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+		{
+			tile[registerIndex] = SimdAddInt16(tile[registerIndex], SimdIntLoad(&weights[registerIndex * INT16_PER_REGISTER]));
+		}
+	}
+
+	while (removedFeatures)
+	{
+		const int16_t* weights = &m_Weights->Weights[getWeightsIndex(bitboardIndex, PopBitAndGetIndex(removedFeatures))][tileOffset];
+		for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+		{
+			tile[registerIndex] = SimdSubInt16(tile[registerIndex], SimdIntLoad(&weights[registerIndex * INT16_PER_REGISTER]));
+		}
+	}
+
+	if constexpr (bitboardIndex + 1 < BitboardFeatureIterator::NumBitboardFeatures())
+	{
+		accumulateTile<bitboardIndex + 1>(newFeaturesIterator, oldFeaturesIterator, tile, tileOffset);
+	}
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::Weights::SetWeights(std::ifstream& weightsFile)
+{
+	// the file holds float weights, they are loaded by the float accumulator and converted here
+	auto floatWeights = std::make_unique<FloatWeights>();
+	floatWeights->SetWeights(weightsFile);
+	Quantize(*floatWeights);
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::Weights::Quantize(const FloatWeights& floatWeights)
+{
+	for (size_t weightsIndex = 0; weightsIndex < BitboardFeatureIterator::NumBitboardFeatures() * BITS_IN_BITBOARD; weightsIndex++)
+	{
+		for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+		{
+			this->Weights[weightsIndex][outputIndex] = ::Quantize<int16_t>(floatWeights.Weights[weightsIndex][outputIndex], QUANTIZED_ACTIVATION_SCALE);
+		}
+	}
+	for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+	{
+		this->Bias[outputIndex] = ::Quantize<int16_t>(floatWeights.Bias[outputIndex], QUANTIZED_ACTIVATION_SCALE);
+	}
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::Reset(const BitboardFeatureIterator& newFeaturesIterator)
+{
+	if constexpr (IS_VECTORIZED)
+	{
+		for (size_t tileOffset = 0; tileOffset < outputSize; tileOffset += TILE_SIZE)
+		{
+			SimdIntVector tile[TILE_REGISTERS];
+			resetTile(newFeaturesIterator, tile, tileOffset);
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				SimdIntStore(&m_Output[tileOffset + registerIndex * INT16_PER_REGISTER], tile[registerIndex]);
+			}
+		}
+		return;
+	}
+
+	std::memcpy(m_Output, m_Weights->Bias, sizeof(m_Output));
+
+	for (size_t bitboardIndex = 0; bitboardIndex < BitboardFeatureIterator::NumBitboardFeatures(); bitboardIndex++)
+	{
+		Bitboard newFeatures = newFeaturesIterator.Get(bitboardIndex);
+
+		while (newFeatures)
+		{
+			const uint32_t featureIndex = PopBitAndGetIndex(newFeatures);
+			const size_t weightsIndex = getWeightsIndex(bitboardIndex, featureIndex);
+
+			for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+			{
+				m_Output[outputIndex] += m_Weights->Weights[weightsIndex][outputIndex];
+			}
+		}
+	}
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::resetTile(const BitboardFeatureIterator& newFeaturesIterator,
+	SimdIntVector(&tile)[TILE_REGISTERS], const size_t tileOffset)
+{
+	for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+	{
+		tile[registerIndex] = SimdIntLoad(&m_Weights->Bias[tileOffset + registerIndex * INT16_PER_REGISTER]);
+	}
+
+	for (size_t bitboardIndex = 0; bitboardIndex < BitboardFeatureIterator::NumBitboardFeatures(); bitboardIndex++)
+	{
+		Bitboard newFeatures = newFeaturesIterator.Get(bitboardIndex);
+
+		while (newFeatures)
+		{
+			const int16_t* weights = &m_Weights->Weights[getWeightsIndex(bitboardIndex, PopBitAndGetIndex(newFeatures))][tileOffset];
+			for (size_t registerIndex = 0; registerIndex < TILE_REGISTERS; registerIndex++)
+			{
+				tile[registerIndex] = SimdAddInt16(tile[registerIndex], SimdIntLoad(&weights[registerIndex * INT16_PER_REGISTER]));
+			}
+		}
+	}
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::ClippedRelu(uint8_t* output) const
+{
+	for (size_t outputIndex = 0; outputIndex < outputSize; outputIndex++)
+	{
+		const int16_t value = m_Output[outputIndex];
+		output[outputIndex] = static_cast<uint8_t>(value < 0 ? 0 : (value > QUANTIZED_ACTIVATION_SCALE ? QUANTIZED_ACTIVATION_SCALE : value));
+	}
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr size_t QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::getWeightsIndex(const size_t bitboardIndex, const uint32_t featureInBitboardIndex)
+{
+	const size_t weightsIndex = bitboardIndex * BITS_IN_BITBOARD + featureInBitboardIndex;
+	DEBUG_ASSERT(weightsIndex < BitboardFeatureIterator::NumBitboardFeatures() * BITS_IN_BITBOARD);
+	return weightsIndex;
+}
+
+template<typename BitboardFeatureIterator, size_t outputSize>
+forceinline constexpr void QuantizedBitboardFeatureAccumulator<BitboardFeatureIterator, outputSize>::validateOutput(const BitboardFeatureIterator& newFeaturesIterator)
+{
+	DEBUG_IF(true)
+	{
+		int16_t outputCopy[outputSize];
+		std::memcpy(outputCopy, m_Output, sizeof(outputCopy));
+		Reset(newFeaturesIterator);
+		if (std::memcmp(outputCopy, m_Output, sizeof(outputCopy)) != 0)
+		{
+			throw std::runtime_error("quantized accumulator does not match a full reset");
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Core/Engine/utils.h"
+#include "Hardware/architecture.h"
+#include "Hardware/avx_utils.h"
+#include "Hardware/simd.h"
+#include "NN/quantization.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+
+// int8 counterpart of DenseLayer, inputs are clipped relu activations in [0, QUANTIZED_ACTIVATION_SCALE]
+// the output is int32 at QUANTIZED_ACTIVATION_SCALE * QUANTIZED_WEIGHT_SCALE, the activation is left to the next layer
+// the float DenseLayer stays the reference implementation, this one is converted from the same float weights
+template<int inputNeurons, int outputNeurons>
+class QuantizedDenseLayer
+{
+public:
+	static constexpr int NUM_INPUT_CHUNKS = inputNeurons / INT8_PER_REGISTER;
+	static constexpr int32_t OUTPUT_SCALE = QUANTIZED_ACTIVATION_SCALE * QUANTIZED_WEIGHT_SCALE;
+	// several outputs are computed at once so that every input load is shared between them
+	static constexpr int OUTPUTS_PARSED = ((outputNeurons % 4) == 0) ? 4 : 1;
+
+	// output major so that the weights of one output neuron are contiguous like the input
+	alignas(CACHE_LINE_SIZE) int8_t Weights[outputNeurons][inputNeurons];
+	alignas(CACHE_LINE_SIZE) int32_t Biases[outputNeurons];
+	alignas(CACHE_LINE_SIZE) int32_t Output[outputNeurons];
+
+	QuantizedDenseLayer()
+	{
+		static_assert((inputNeurons % INT8_PER_REGISTER) == 0,
+			"Incorrect quantized dense layer input size, must be a multiple of INT8_PER_REGISTER (16/32/64 depending on SSE/AVX2/AVX512BW architecture)");
+	}
+
+	// reads the float weights file DenseLayer::ReadWeights reads and quantizes it
+	forceinline void ReadWeights(std::ifstream& weightsFile)
+	{
+		auto weightsFromFile = std::make_unique<float[]>(inputNeurons * outputNeurons);
+		auto biasesFromFile = std::make_unique<float[]>(outputNeurons);
+		weightsFile.read((char*)weightsFromFile.get(), inputNeurons * outputNeurons * sizeof(float));
+		weightsFile.read((char*)biasesFromFile.get(), outputNeurons * sizeof(float));
+		SetWeights(weightsFromFile.get(), biasesFromFile.get());
+	}
+
+	// same layout as DenseLayer::SetWeights, weights[inputNeuronIndex * outputNeurons + outputNeuronIndex]
+	forceinline void SetWeights(const float* weights, const float* biases)
+	{
+		for (int inputNeuronIndex = 0; inputNeuronIndex < inputNeurons; inputNeuronIndex++)
+		{
+			for (int outputNeuronIndex = 0; outputNeuronIndex < outputNeurons; outputNeuronIndex++)
+			{
+				Weights[outputNeuronIndex][inputNeuronIndex] =
+					Quantize<int8_t>(weights[inputNeuronIndex * outputNeurons + outputNeuronIndex], QUANTIZED_WEIGHT_SCALE);
+			}
+		}
+		for (int outputNeuronIndex = 0; outputNeuronIndex < outputNeurons; outputNeuronIndex++)
+		{
+			Biases[outputNeuronIndex] = Quantize<int32_t>(biases[outputNeuronIndex], OUTPUT_SCALE);
+		}
+	}
+
+	// input has to be cache line aligned
+	forceinline int32_t* Forward(const uint8_t* input)
+	{
+		for (int outputNeuronIndex = 0; outputNeuronIndex < outputNeurons; outputNeuronIndex += OUTPUTS_PARSED)
+		{
+			SimdIntVector outputSums[OUTPUTS_PARSED];
+			for (int outputInPass = 0; outputInPass < OUTPUTS_PARSED; outputInPass++)
+			{
+				outputSums[outputInPass] = SimdIntSetZero();
+			}
+
+			for (int inputChunk = 0, inputIndex = 0; inputChunk < NUM_INPUT_CHUNKS; inputChunk++, inputIndex += INT8_PER_REGISTER)
+			{
+				const SimdIntVector inputs = SimdIntLoad(&input[inputIndex]);
+				for (int outputInPass = 0; outputInPass < OUTPUTS_PARSED; outputInPass++)
+				{
+					const SimdIntVector weights = SimdIntLoad(&Weights[outputNeuronIndex + outputInPass][inputIndex]);
+					outputSums[outputInPass] = SimdDotProductAccumulate(outputSums[outputInPass], inputs, weights);
+				}
+			}
+
+			for (int outputInPass = 0; outputInPass < OUTPUTS_PARSED; outputInPass++)
+			{
+				Output[outputNeuronIndex + outputInPass] = Biases[outputNeuronIndex + outputInPass] + SimdIntHorizontalSum(outputSums[outputInPass]);
+			}
+		}
+		return Output;
+	}
+
+	forceinline static constexpr float Dequantize(const int32_t output) { return static_cast<float>(output) / OUTPUT_SCALE; }
+};
@@ -11,6 +11,7 @@ class SearchCancellationPolicy
 public:
 	SearchCancellationPolicy(const TimePoint& startTime, const SearchConstraints& searchConstraints);
 
+	forceinline void Abort() { m_SearchAbortedFlag.test_and_set(); }
 	forceinline bool CheckForAbort(uint64_t nodes);
 	forceinline constexpr size_t GetNodeLimit() const { return m_NodeCancellationPolicy.GetNodeLimit(); }
 	forceinline constexpr int64_t GetTimeLimit() const { return m_TimeCancellationPolicy.GetTimeLimit(); }
@@ -1,42 +1,54 @@
 #pragma once
 #include "Core/Engine/utils.h"
 #include "Search/SearchContext/shared_search_context.h"
+#include "Search/move_picker.h"
 #include <cstdint>
 
 class IndividualSearchContext
 {
 public:
-	forceinline IndividualSearchContext(SharedSearchContext& sharedSearchContext, const int64_t depthToSearchTo);
+	forceinline IndividualSearchContext(SharedSearchContext& sharedSearchContext, ButterflyHistory& history, const int64_t depthToSearchTo, const size_t threadIndex = 0);
 	size_t Nodes{ 0ULL };
 
 	forceinline constexpr operator SharedSearchContext&() { return m_SharedSearchContext; }
-	forceinline void MakeMove();
-	forceinline void UndoMove();
+	// a reduction takes that many plies off the child's remaining depth on top of the one ply the move itself costs
+	forceinline void MakeMove(const int64_t reduction = 0);
+	forceinline void UndoMove(const int64_t reduction = 0);
 
+	forceinline constexpr ButterflyHistory& GetHistory() { return m_History; }
+	forceinline constexpr KillerMoves& GetKillerMoves() { return m_KillerMoves; }
 	forceinline int64_t GetSearchDepth() const { return m_SearchDepth; }
 	forceinline int64_t GetRemainingDepth() const { return m_RemainingDepth; }
+	forceinline bool IsMainThread() const { return m_ThreadIndex == 0; }
 
 private:
 	SharedSearchContext& m_SharedSearchContext;
+	// history outlives a single iteration so it is owned by whoever runs the iterative deepening loop
+	ButterflyHistory& m_History;
+	KillerMoves m_KillerMoves;
 	int64_t m_RemainingDepth{ 0ULL };
 	int64_t m_SearchDepth{ 0ULL };
+	size_t m_ThreadIndex{ 0ULL };
 };
 
-forceinline IndividualSearchContext::IndividualSearchContext(SharedSearchContext& sharedSearchContext, const int64_t depthToSearchTo) :
+forceinline IndividualSearchContext::IndividualSearchContext(SharedSearchContext& sharedSearchContext, ButterflyHistory& history, const int64_t depthToSearchTo, const size_t threadIndex) :
 	m_SharedSearchContext(sharedSearchContext),
+	m_History(history),
+	m_KillerMoves{},
 	m_RemainingDepth(depthToSearchTo),
-	m_SearchDepth(0)
+	m_SearchDepth(0),
+	m_ThreadIndex(threadIndex)
 	{}
 
 
-forceinline void IndividualSearchContext::MakeMove()
+forceinline void IndividualSearchContext::MakeMove(const int64_t reduction)
 {
 	m_SearchDepth++;
-	m_RemainingDepth--;
+	m_RemainingDepth -= 1 + reduction;
 }
 
-forceinline void IndividualSearchContext::UndoMove()
+forceinline void IndividualSearchContext::UndoMove(const int64_t reduction)
 {
 	m_SearchDepth--;
-	m_RemainingDepth++;
+	m_RemainingDepth += 1 + reduction;
 }
@@ -6,6 +6,7 @@
 #include "SearchCancellationPolicies/search_time_cancellation_policy.h"
 #include <Search/search_constraints.h>
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <limits>
 
@@ -15,7 +16,9 @@ public:
 	SharedSearchContext(const SearchConstraints searchConstraints, const TimePoint& searchStartTimepoint,
 		TranspositionTable* transposition_table);
 
+	forceinline void AddHelperNodes(const size_t nodes) { m_HelperNodes.fetch_add(nodes, std::memory_order_relaxed); }
 	forceinline constexpr SearchCancellationPolicy& GetCancellationPolicy() { return m_CancellationPolicy; }
+	forceinline size_t GetHelperNodes() const { return m_HelperNodes.load(std::memory_order_relaxed); }
 	forceinline constexpr TranspositionTable& GetTranspositionTable() { return *m_TranspositionTable; }
 	forceinline constexpr const TranspositionTable& GetTranspositionTable() const { return *m_TranspositionTable; }
 	forceinline constexpr int64_t GetSearchDepth() const { return m_SearchDepth; }
@@ -26,6 +29,8 @@ private:
 	TranspositionTable* m_TranspositionTable;
 	SearchCancellationPolicy m_CancellationPolicy;
 	int64_t m_SearchDepth;
+	// nodes searched by lazy smp helpers, they get published at the end of every helper iteration
+	std::atomic<size_t> m_HelperNodes;
 };
 
 
@@ -33,7 +38,8 @@ SharedSearchContext::SharedSearchContext(const SearchConstraints searchConstrain
 	TranspositionTable* transposition_table) :
 	m_TranspositionTable(transposition_table),
 	m_CancellationPolicy(searchStartTimepoint, searchConstraints),
-	m_SearchDepth(calculateSearchDepth(searchConstraints))
+	m_SearchDepth(calculateSearchDepth(searchConstraints)),
+	m_HelperNodes{ 0 }
 {
 }
 
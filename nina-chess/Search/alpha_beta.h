@@ -7,4 +7,6 @@ struct AlphaBeta
 	Score Alpha;
 	const Score Beta;
 	forceinline constexpr AlphaBeta Invert() const { return { -Beta, -Alpha }; }
+	// only answers whether a move beats alpha, which is all a move after the first one has to prove
+	forceinline constexpr AlphaBeta ZeroWindow() const { return { Alpha, Alpha + Score(1) }; }
 };
@@ -0,0 +1,244 @@
+#pragma once
+#include "Chess/chess_constants.h"
+#include "Chess/color.h"
+#include "Chess/move.h"
+#include "Chess/piece_type.h"
+#include "Chess/position.h"
+#include "Core/Engine/utils.h"
+#include "MoveGen/move_list.h"
+#include "Search/search_core.h"
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// quiet moves that caused a beta cutoff, kept per ply with the most recent one first
+class KillerMoves
+{
+public:
+	inline static constexpr size_t NUM_KILLERS = 2;
+
+	forceinline constexpr void Add(const int64_t ply, const Move& move);
+	forceinline constexpr const Move& Get(const int64_t ply, const size_t killerIndex) const { return m_Moves[ply][killerIndex]; }
+
+private:
+	Move m_Moves[MAX_PLY][NUM_KILLERS]{};
+};
+
+// butterfly history, indexed by side to move and the from/to squares of quiet moves
+// scores use a gravity update so they saturate at MAX_HISTORY instead of growing without bound
+class ButterflyHistory
+{
+public:
+	inline static constexpr int32_t MAX_HISTORY = 1 << 14;
+
+	forceinline ButterflyHistory() { Clear(); }
+
+	forceinline void Clear() { std::memset(m_Scores, 0, sizeof(m_Scores)); }
+	template<Color sideToMove>
+	forceinline constexpr int32_t Get(const Move& move) const { return m_Scores[sideToMove][move.FromIndex()][move.ToIndex()]; }
+	template<Color sideToMove>
+	forceinline constexpr void Update(const Move& move, const int32_t bonus);
+
+private:
+	int32_t m_Scores[COLOR_NONE][NUM_BOARD_SQUARES][NUM_BOARD_SQUARES];
+};
+
+enum class MovePickerStage
+{
+	TT_MOVE,
+	CAPTURES,
+	KILLERS,
+	QUIETS,
+	DONE
+};
+
+// hands out the moves of an already generated move list in the order they are most likely to cause a cutoff:
+// the transposition table move, captures and promotions by MVV-LVA, killers and finally quiets by history
+// every stage is only sorted when it is reached, so a cutoff on an early move skips the later work
+template<Color sideToMove>
+class MovePicker
+{
+public:
+	forceinline MovePicker(const Position& position, const MoveList& moveList, const uint16_t transpositionTableMove,
+		const KillerMoves& killerMoves, const int64_t ply, const ButterflyHistory& history);
+
+	forceinline Move Next();
+
+private:
+	struct ScoredMove
+	{
+		Move Move;
+		int32_t Score;
+	};
+
+	forceinline int32_t getMvvLvaScore(const Move& move) const;
+	forceinline Move pickBest(const uint32_t last);
+
+	// in a union so that the moves are not default constructed on every node, the constructor fills what is used
+	union
+	{
+		ScoredMove m_Moves[MoveList::MAX_MOVES];
+	};
+	const Position& m_Position;
+	const KillerMoves& m_KillerMoves;
+	const ButterflyHistory& m_History;
+	Move m_TranspositionTableMove;
+	int64_t m_Ply;
+	uint32_t m_NumCaptures;
+	uint32_t m_NumMoves;
+	uint32_t m_CurrentMove;
+	MovePickerStage m_Stage;
+};
+
+
+forceinline constexpr void KillerMoves::Add(const int64_t ply, const Move& move)
+{
+	if (m_Moves[ply][0] == move)
+		return;
+
+	m_Moves[ply][1] = m_Moves[ply][0];
+	m_Moves[ply][0] = move;
+}
+
+template<Color sideToMove>
+forceinline constexpr void ButterflyHistory::Update(const Move& move, const int32_t bonus)
+{
+	int32_t& score = m_Scores[sideToMove][move.FromIndex()][move.ToIndex()];
+	const int32_t clampedBonus = bonus < MAX_HISTORY ? bonus : MAX_HISTORY;
+	score += clampedBonus - score * clampedBonus / MAX_HISTORY;
+}
+
+template<Color sideToMove>
+forceinline MovePicker<sideToMove>::MovePicker(const Position& position, const MoveList& moveList, const uint16_t transpositionTableMove,
+	const KillerMoves& killerMoves, const int64_t ply, const ButterflyHistory& history) :
+	m_Position(position),
+	m_KillerMoves(killerMoves),
+	m_History(history),
+	m_TranspositionTableMove(NULL_MOVE),
+	m_Ply(ply),
+	m_NumCaptures(0),
+	m_NumMoves(0),
+	m_CurrentMove(0),
+	m_Stage(MovePickerStage::TT_MOVE)
+{
+	// captures and promotions are packed at the front, quiets after them
+	// the tt move is taken out of the list altogether, it is returned before any of the stages
+	for (uint32_t moveIndex = 0; moveIndex < moveList.GetNumMoves(); moveIndex++)
+	{
+		const Move& move = moveList[moveIndex];
+		if (transpositionTableMove && move.ToPackedMove() == transpositionTableMove)
+		{
+			m_TranspositionTableMove = move;
+		}
+		else if (move.IsCapture() || move.IsPromotion())
+		{
+			m_Moves[m_NumCaptures++] = { move, getMvvLvaScore(move) };
+		}
+	}
+
+	m_NumMoves = m_NumCaptures;
+	for (uint32_t moveIndex = 0; moveIndex < moveList.GetNumMoves(); moveIndex++)
+	{
+		const Move& move = moveList[moveIndex];
+		if (!move.IsCapture() && !move.IsPromotion() && move.ToPackedMove() != transpositionTableMove)
+		{
+			m_Moves[m_NumMoves++] = { move, 0 };
+		}
+	}
+}
+
+template<Color sideToMove>
+forceinline Move MovePicker<sideToMove>::Next()
+{
+	switch (m_Stage)
+	{
+	case MovePickerStage::TT_MOVE:
+		m_Stage = MovePickerStage::CAPTURES;
+		if (m_TranspositionTableMove)
+			return m_TranspositionTableMove;
+		[[fallthrough]];
+
+	case MovePickerStage::CAPTURES:
+		if (m_CurrentMove < m_NumCaptures)
+			return pickBest(m_NumCaptures);
+		m_Stage = MovePickerStage::KILLERS;
+		[[fallthrough]];
+
+	case MovePickerStage::KILLERS:
+		// killers come from sibling nodes, they are only played if they are among this node's quiets
+		// a found killer is swapped to the front of the quiets so that the quiet stage skips it
+		for (size_t killerIndex = 0; killerIndex < KillerMoves::NUM_KILLERS; killerIndex++)
+		{
+			const Move& killer = m_KillerMoves.Get(m_Ply, killerIndex);
+			if (!killer)
+				continue;
+
+			for (uint32_t moveIndex = m_CurrentMove; moveIndex < m_NumMoves; moveIndex++)
+			{
+				if (m_Moves[moveIndex].Move == killer)
+				{
+					std::swap(m_Moves[moveIndex], m_Moves[m_CurrentMove]);
+					return m_Moves[m_CurrentMove++].Move;
+				}
+			}
+		}
+
+		for (uint32_t moveIndex = m_CurrentMove; moveIndex < m_NumMoves; moveIndex++)
+		{
+			m_Moves[moveIndex].Score = m_History.Get<sideToMove>(m_Moves[moveIndex].Move);
+		}
+		m_Stage = MovePickerStage::QUIETS;
+		[[fallthrough]];
+
+	case MovePickerStage::QUIETS:
+		if (m_CurrentMove < m_NumMoves)
+			return pickBest(m_NumMoves);
+		m_Stage = MovePickerStage::DONE;
+		[[fallthrough]];
+
+	case MovePickerStage::DONE:
+	default:
+		return NULL_MOVE;
+	}
+}
+
+template<Color sideToMove>
+forceinline int32_t MovePicker<sideToMove>::getMvvLvaScore(const Move& move) const
+{
+	constexpr int32_t PIECE_VALUES[PIECE_TYPE_NONE + 1] = { 1, 3, 3, 5, 9, 0, 0 };
+	constexpr Color oppositeSide = GetOppositeColor<sideToMove>();
+
+	PieceType victim = PIECE_TYPE_NONE;
+	if (move.GetMoveType() == MoveType::EN_PASSANT)
+	{
+		victim = PAWN;
+	}
+	else if (move.IsCapture())
+	{
+		const Side& enemyPieces = m_Position.GetSide<oppositeSide>();
+		for (PieceType pieceType = PAWN; pieceType < KING; pieceType++)
+		{
+			if (enemyPieces.GetPieceBitboard(pieceType) & move.ToBitmask())
+			{
+				victim = pieceType;
+				break;
+			}
+		}
+	}
+
+	return (PIECE_VALUES[victim] + PIECE_VALUES[move.PromotionPieceType()]) * 16 - PIECE_VALUES[move.MovingPieceType()];
+}
+
+template<Color sideToMove>
+forceinline Move MovePicker<sideToMove>::pickBest(const uint32_t last)
+{
+	uint32_t bestIndex = m_CurrentMove;
+	for (uint32_t moveIndex = m_CurrentMove + 1; moveIndex < last; moveIndex++)
+	{
+		if (m_Moves[moveIndex].Score > m_Moves[bestIndex].Score)
+			bestIndex = moveIndex;
+	}
+
+	std::swap(m_Moves[bestIndex], m_Moves[m_CurrentMove]);
+	return m_Moves[m_CurrentMove++].Move;
+}
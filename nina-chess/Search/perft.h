@@ -2,23 +2,32 @@
 #include "Chess/color.h"
 #include "Chess/position.h"
 #include "Eval/evaluator.h"
+#include "MoveGen/move_gen.h"
+#include "MoveGen/move_list.h"
+#include "Search/perft_hash_table.h"
 #include "Search/position_stack.h"
 #include "Search/search.h"
 #include "Search/search_constraints.h"
 #include "Search/transposition_table.h"
 #include "SearchContext/shared_search_context.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
-inline size_t TestSearch(const bool hideOutput = false, const size_t depthLimit = std::numeric_limits<size_t>::max());
+inline size_t TestSearch(const bool hideOutput = false, const size_t depthLimit = std::numeric_limits<size_t>::max(), const size_t ttSizeInMb = 16);
+inline double TestBranchingFactor(const bool hideOutput, const int searchDepth);
 
 struct PerftTestEntry
 {
@@ -117,6 +126,150 @@ inline void Perft(PositionStack& PositionStack, PerftInfo& perftInfo)
 	}
 }
 
+// counts the leaves without visiting them, the last ply is just the size of the move list
+// subtrees already counted are taken from the perft hash table when one is given
+template<Color sideToMove>
+inline uint64_t PerftBulk(PositionStack& positionStack, const size_t remainingDepth, PerftHashTable* perftHashTable)
+{
+	constexpr Color oppositeSide = GetOppositeColor<sideToMove>();
+	const Position& position = positionStack.GetCurrentPosition();
+
+	if (remainingDepth == 0)
+	{
+		return 1;
+	}
+
+	const auto& moveList = positionStack.GetMoveListSkippingHashCheck<sideToMove>();
+	if (remainingDepth == 1)
+	{
+		return moveList.GetNumMoves();
+	}
+
+	uint64_t nodes = 0;
+	if (perftHashTable && perftHashTable->Probe(position.Hash, remainingDepth, nodes))
+	{
+		return nodes;
+	}
+
+	nodes = 0;
+	Position& newPosition = positionStack.GetNextPosition();
+	for (uint32_t moveId = 0; moveId < moveList.GetNumMoves(); moveId++)
+	{
+		Position::MakeMove<sideToMove>(position, newPosition, moveList[moveId]);
+
+		positionStack.IncrementDepth();
+		nodes += PerftBulk<oppositeSide>(positionStack, remainingDepth - 1, perftHashTable);
+		positionStack.DecrementDepth();
+	}
+
+	if (perftHashTable)
+	{
+		perftHashTable->Insert(position.Hash, remainingDepth, nodes);
+	}
+
+	return nodes;
+}
+
+// splits the root moves over numThreads threads, every thread grabs the next unclaimed root move when it is done with its last one
+// perftHashTable may be null to count without one, divide prints the subtree size of every root move
+inline uint64_t RunPerft(const Position& position, const size_t depth, const size_t numThreads, PerftHashTable* perftHashTable, const bool divide)
+{
+	if (depth == 0)
+	{
+		return 1;
+	}
+
+	std::unique_ptr<MoveList> rootMoveList = std::make_unique<MoveList>();
+	GenerateMoves(position, *rootMoveList);
+
+	std::vector<uint64_t> rootMoveNodes(rootMoveList->GetNumMoves(), 0);
+	std::atomic<uint32_t> nextRootMove = 0;
+	std::vector<std::exception_ptr> exceptions(std::max<size_t>(numThreads, 1));
+
+	const auto perftThreadFunction = [&](const size_t threadIndex)
+	{
+		try
+		{
+			std::unique_ptr<PositionStack> positionStack = std::make_unique<PositionStack>();
+			for (uint32_t moveId = nextRootMove++; moveId < rootMoveList->GetNumMoves(); moveId = nextRootMove++)
+			{
+				positionStack->Reset(position);
+				positionStack->MakeMove((*rootMoveList)[moveId]);
+				rootMoveNodes[moveId] = positionStack->GetCurrentPosition().SideToMove == WHITE ?
+					PerftBulk<WHITE>(*positionStack, depth - 1, perftHashTable) :
+					PerftBulk<BLACK>(*positionStack, depth - 1, perftHashTable);
+			}
+		}
+		catch (...)
+		{
+			exceptions[threadIndex] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> perftThreads;
+	for (size_t threadIndex = 1; threadIndex < exceptions.size(); threadIndex++)
+	{
+		perftThreads.emplace_back(perftThreadFunction, threadIndex);
+	}
+	perftThreadFunction(0);
+	for (auto& perftThread : perftThreads)
+	{
+		perftThread.join();
+	}
+
+	for (const auto& exception : exceptions)
+	{
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	uint64_t totalNodes = 0;
+	for (uint32_t moveId = 0; moveId < rootMoveList->GetNumMoves(); moveId++)
+	{
+		if (divide)
+			std::cout << (*rootMoveList)[moveId].ToUciMove() << ": " << rootMoveNodes[moveId] << "\n";
+		totalNodes += rootMoveNodes[moveId];
+	}
+
+	return totalNodes;
+}
+
+// the whole perft suite through RunPerft, meant for validating move generation changes at depths TestPerft is too slow for
+inline bool TestPerftSuite(const size_t numThreads, const size_t hashSizeInMb, const size_t nodeLimit)
+{
+	const auto& testPositions = ParsePerftTestSuite("./test/perftsuite.epd");
+	// keyed on the full hash, so one table serves every position of the suite
+	std::unique_ptr<PerftHashTable> perftHashTable = hashSizeInMb ? std::make_unique<PerftHashTable>(hashSizeInMb) : nullptr;
+
+	size_t totalNodes = 0;
+	double totalDuration = 0;
+
+	for (const auto& testPosition : testPositions)
+	{
+		if (testPosition.ExpectedNodes > nodeLimit)
+		{
+			continue;
+		}
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		const uint64_t nodes = RunPerft(Position::ParseFen(testPosition.Fen), testPosition.Depth, numThreads, perftHashTable.get(), false);
+		const auto stop = std::chrono::high_resolution_clock::now();
+
+		totalDuration += double(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count()) / 1000000;
+		totalNodes += nodes;
+
+		if (nodes != testPosition.ExpectedNodes)
+		{
+			std::cout << "found error in position " << testPosition.Fen << " depth " << testPosition.Depth <<
+				", expected " << testPosition.ExpectedNodes << ", received " << nodes << std::endl;
+			return false;
+		}
+	}
+
+	std::cout << "perft suite passed, nodes " << totalNodes << " nps " << size_t(double(totalNodes) / totalDuration) << std::endl;
+	return true;
+}
+
 inline size_t TestPerft(const bool hideOutput, const size_t nodeLimit)
 {
 	PositionStack* positionStackMemory = new PositionStack;
@@ -184,7 +337,7 @@ inline size_t TestPerft(const bool hideOutput, const size_t nodeLimit)
 	return nps;
 }
 
-inline size_t TestSearch(const bool hideOutput, const size_t depthLimit)
+inline size_t TestSearch(const bool hideOutput, const size_t depthLimit, const size_t ttSizeInMb)
 {
 	try
 	{
@@ -193,8 +346,7 @@ inline size_t TestSearch(const bool hideOutput, const size_t depthLimit)
 		Evaluator* evaluatorMemory = new Evaluator();
 		Evaluator& evaluator = *evaluatorMemory;
 
-		constexpr size_t tt_size = 16;
-		TranspositionTable* transpositionTable = new TranspositionTable(tt_size);
+		TranspositionTable* transpositionTable = new TranspositionTable(ttSizeInMb);
 
 		SearchConstraints searchConstraints;
 
@@ -249,3 +401,73 @@ inline size_t TestSearch(const bool hideOutput, const size_t depthLimit)
 	}
 	
 }
+
+// effective branching factor: the depth-th root of the nodes the last iteration needed, averaged geometrically
+// over every position of the suite. The lower it is, the more of the tree move ordering and pruning manage to cut
+inline double TestBranchingFactor(const bool hideOutput, const int searchDepth)
+{
+	try
+	{
+		PositionStack* positionStackMemory = new PositionStack;
+		PositionStack& positionStack = *positionStackMemory;
+		Evaluator* evaluatorMemory = new Evaluator();
+		Evaluator& evaluator = *evaluatorMemory;
+
+		constexpr size_t tt_size = 16;
+		TranspositionTable* transpositionTable = new TranspositionTable(tt_size);
+
+		SearchConstraints searchConstraints;
+		searchConstraints.Depth = searchDepth;
+
+		const auto& testPositions = ParsePerftTestSuite("./test/perftsuite.epd");
+
+		double sumOfLogBranchingFactors = 0;
+		size_t numPositions = 0;
+
+		std::string previousFen;
+		for (const auto& testPosition : testPositions)
+		{
+			if (testPosition.Fen == previousFen)
+			{
+				continue;
+			}
+			previousFen = testPosition.Fen;
+
+			// every position starts from an empty table so that earlier positions don't make later ones look cheaper
+			transpositionTable->Clear();
+			positionStack.Reset(Position::ParseFen(testPosition.Fen));
+			evaluator.Reset(positionStack);
+
+			SharedSearchContext searchContext(searchConstraints, std::chrono::high_resolution_clock().now(), transpositionTable);
+			const auto& searchResults = StartSearch<false>(positionStack, evaluator, searchContext);
+
+			const SearchResult& lastResult = searchResults.back();
+			if (lastResult.Nodes == 0)
+			{
+				continue;
+			}
+
+			const double branchingFactor = std::pow(double(lastResult.Nodes), 1.0 / double(lastResult.Depth));
+			sumOfLogBranchingFactors += std::log(branchingFactor);
+			numPositions++;
+
+			if (!hideOutput)
+				std::cout << testPosition.Fen << " nodes " << lastResult.Nodes << " branching factor " << branchingFactor << "\n";
+		}
+
+		const double branchingFactor = std::exp(sumOfLogBranchingFactors / double(numPositions));
+
+		if (!hideOutput)
+			std::cout << "effective branching factor: " << branchingFactor << "\n";
+
+		delete positionStackMemory;
+		delete evaluatorMemory;
+		delete transpositionTable;
+		return branchingFactor;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << "Search failed: " << ex.what() << "\n";
+		return 0;
+	}
+}
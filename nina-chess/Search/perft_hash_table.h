@@ -0,0 +1,66 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// subtree sizes of positions already counted by perft, shared by all perft threads
+// the remaining depth is folded into the key, the same position reached with a different depth left is a different entry
+// the key is stored xored with the node count so that a torn write from another thread is rejected by Probe
+class PerftHashTable
+{
+public:
+	forceinline PerftHashTable(const size_t sizeInMb);
+
+	forceinline bool Probe(const uint64_t hash, const size_t remainingDepth, uint64_t& nodes) const;
+	forceinline void Insert(const uint64_t hash, const size_t remainingDepth, const uint64_t nodes);
+
+private:
+	struct Entry
+	{
+		std::atomic<uint64_t> XoredKey;
+		std::atomic<uint64_t> Nodes;
+	};
+
+	forceinline static constexpr uint64_t getKey(const uint64_t hash, const size_t remainingDepth)
+	{
+		return hash ^ (uint64_t(remainingDepth) * 0x9E3779B97F4A7C15ULL);
+	}
+	forceinline Entry& getEntry(const uint64_t key) const { return m_Entries[key & (m_NumEntries - 1)]; }
+
+	std::unique_ptr<Entry[]> m_Entries;
+	size_t m_NumEntries;
+};
+
+
+forceinline PerftHashTable::PerftHashTable(const size_t sizeInMb) :
+	m_Entries{},
+	m_NumEntries{ 1 }
+{
+	// rounded down to a power of two so that the index is a mask
+	const size_t maxEntries = sizeInMb * 1024 * 1024 / sizeof(Entry);
+	while (m_NumEntries * 2 <= maxEntries)
+	{
+		m_NumEntries *= 2;
+	}
+	m_Entries = std::make_unique<Entry[]>(m_NumEntries);
+}
+
+forceinline bool PerftHashTable::Probe(const uint64_t hash, const size_t remainingDepth, uint64_t& nodes) const
+{
+	const uint64_t key = getKey(hash, remainingDepth);
+	const Entry& entry = getEntry(key);
+
+	nodes = entry.Nodes.load(std::memory_order_relaxed);
+	return nodes != 0 && (entry.XoredKey.load(std::memory_order_relaxed) ^ nodes) == key;
+}
+
+forceinline void PerftHashTable::Insert(const uint64_t hash, const size_t remainingDepth, const uint64_t nodes)
+{
+	const uint64_t key = getKey(hash, remainingDepth);
+	Entry& entry = getEntry(key);
+
+	entry.XoredKey.store(key ^ nodes, std::memory_order_relaxed);
+	entry.Nodes.store(nodes, std::memory_order_relaxed);
+}
@@ -15,7 +15,7 @@ public:
 
 	template<Color sideToMove>
 	forceinline constexpr MoveList& GetMoveListSkippingHashCheck();
-	template<Color sideToMove>
+	template<Color sideToMove, GenType genType = GenType::ALL>
 	forceinline constexpr MoveList& GetMoveList();
 
 	forceinline constexpr void DecrementDepth() { --m_Depth; }
@@ -32,13 +32,17 @@ public:
 	forceinline constexpr void SetCurrentPosition(const Position& position);
 
 	forceinline Position& MakeMove(const Move& move);
+	template<Color sideToMove>
+	forceinline Position& MakeNullMove();
 	forceinline void UndoMove() { DecrementDepth(); }
+	forceinline constexpr bool IsAfterNullMove() const { return m_IsAfterNullMove[m_Depth]; }
 
 private:
 	forceinline constexpr uint64_t GetHashAtPly(const int64_t ply) const { return m_PositionStack[ply].Hash; }
 
 	MoveList m_MoveListStack[MAX_PLY];
 	Position m_PositionStack[MAX_PLY];
+	bool m_IsAfterNullMove[MAX_PLY];
 	int64_t m_Depth;
 };
 
@@ -46,6 +50,7 @@ private:
 forceinline PositionStack::PositionStack() :
 	m_MoveListStack{},
 	m_PositionStack{},
+	m_IsAfterNullMove{},
 	m_Depth{ 0 }
 {
 }
@@ -54,6 +59,7 @@ forceinline void PositionStack::Reset(const Position& pos)
 {
 	m_PositionStack[0] = pos;
 	GenerateMoves(pos, m_MoveListStack[0]);
+	m_IsAfterNullMove[0] = false;
 	m_Depth = 0;
 }
 
@@ -64,6 +70,11 @@ forceinline constexpr bool PositionStack::IsThreefoldRepetition() const
 
 	for (int64_t ply = m_Depth - 2; ply >= plyToSearchTo; ply -= 2)
 	{
+		// a null move in between means the earlier position was never actually on the board in this line
+		if (m_IsAfterNullMove[ply + 1] || m_IsAfterNullMove[ply + 2])
+		{
+			return false;
+		}
 		if (currentPosition.Hash == GetHashAtPly(ply))
 		{
 			return true;
@@ -88,6 +99,18 @@ forceinline Position& PositionStack::MakeMove(const Move& move)
 	auto& nextPosition = GetNextPosition();
 	Position::MakeMove(currentPosition, nextPosition, move);
 	IncrementDepth();
+	m_IsAfterNullMove[m_Depth] = false;
+	return nextPosition;
+}
+
+template<Color sideToMove>
+forceinline Position& PositionStack::MakeNullMove()
+{
+	auto& currentPosition = GetCurrentPosition();
+	auto& nextPosition = GetNextPosition();
+	Position::MakeNullMove<sideToMove>(currentPosition, nextPosition);
+	IncrementDepth();
+	m_IsAfterNullMove[m_Depth] = true;
 	return nextPosition;
 }
 
@@ -108,7 +131,8 @@ forceinline constexpr Position& PositionStack::GetNextPosition()
 
 forceinline constexpr MoveList& PositionStack::GetMoveListAt(const int64_t depthOfPosition)
 {
-	if (m_MoveListStack[depthOfPosition].GetHashOfPosition() != m_PositionStack[depthOfPosition].Hash)
+	if (m_MoveListStack[depthOfPosition].GetHashOfPosition() != m_PositionStack[depthOfPosition].Hash ||
+		m_MoveListStack[depthOfPosition].GetGenType() != GenType::ALL)
 		GenerateMoves(m_PositionStack[depthOfPosition], m_MoveListStack[depthOfPosition]);
 	return m_MoveListStack[depthOfPosition];
 }
@@ -122,14 +146,15 @@ forceinline constexpr MoveList& PositionStack::GetMoveList()
 		return GetMoveList<BLACK>();
 }
 
-template<Color sideToMove>
+template<Color sideToMove, GenType genType>
 forceinline constexpr MoveList& PositionStack::GetMoveList()
 {
 	const Position& currentPosition = GetCurrentPosition();
 	MoveList& currentMoveList = m_MoveListStack[m_Depth];
-	if (currentMoveList.GetHashOfPosition() != currentPosition.Hash)
+	// a list generated for the same position with a different gen type does not hold the same moves
+	if (currentMoveList.GetHashOfPosition() != currentPosition.Hash || currentMoveList.GetGenType() != genType)
 	{
-		GenerateMoves<sideToMove>(currentPosition, currentMoveList);
+		GenerateMoves<sideToMove, genType>(currentPosition, currentMoveList);
 	}
 	return currentMoveList;
 }
@@ -10,27 +10,56 @@
 #include "Search/SearchContext/individual_search_context.h"
 #include "Search/SearchContext/shared_search_context.h"
 #include "Search/alpha_beta.h"
+#include "Search/move_picker.h"
 #include "Search/position_stack.h"
 #include "Search/search_result.h"
+#include "Search/search_thread.h"
 #include "Search/transposition_table.h"
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <exception>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <ostream>
+#include <thread>
 #include <utility>
 #include <vector>
 
+inline constexpr int64_t ASPIRATION_MIN_DEPTH = 4;
+inline constexpr int32_t ASPIRATION_INITIAL_MARGIN = 25;
+inline constexpr int64_t NULL_MOVE_MIN_DEPTH = 3;
+inline constexpr int64_t NULL_MOVE_BASE_REDUCTION = 2;
+inline constexpr int64_t LATE_MOVE_REDUCTION_MIN_DEPTH = 3;
+inline constexpr uint32_t LATE_MOVE_REDUCTION_MIN_MOVES = 3;
+
+// reductions grow with both the remaining depth and how many moves have been searched before, indexed [depth][move]
+inline const auto LATE_MOVE_REDUCTIONS = []
+{
+	std::array<std::array<int64_t, 64>, 64> reductions{};
+	for (size_t depth = 1; depth < reductions.size(); depth++)
+	{
+		for (size_t moveNumber = 1; moveNumber < reductions[depth].size(); moveNumber++)
+		{
+			reductions[depth][moveNumber] = int64_t(0.75 + std::log(double(depth)) * std::log(double(moveNumber)) / 2.25);
+		}
+	}
+	return reductions;
+}();
+
 template<bool showOutput>	
 forceinline std::vector<SearchResult> StartSearch(PositionStack& posStack, SharedSearchContext& searchContext);
+template<bool showOutput>
+forceinline std::vector<SearchResult> StartSearch(PositionStack& positionStack, Evaluator& evaluator, SharedSearchContext& searchContext, SearchHelpers& searchHelpers);
 
 
-forceinline Score GetScoreFromTranspositionTable(const Position& position,
-	const AlphaBeta& alphaBeta, const TranspositionTable& transpositionTable, const int64_t remainingDepth)
+forceinline Score GetScoreFromTranspositionTable(const bool transpositionTableHit, const TranspositionTableEntry& transpositionTableEntry,
+	const AlphaBeta& alphaBeta, const int64_t remainingDepth)
 {
-	const TranspositionTableEntry& transpositionTableEntry = transpositionTable.Get(position.Hash);
-
-	if (transpositionTableEntry.Key == position.Hash)
+	if (transpositionTableHit)
 	{
 		if (transpositionTableEntry.Depth >= remainingDepth)
 		{
@@ -81,25 +110,37 @@ public:
 	IncrementalUpdater(Evaluator& evaluator, PositionStack& positionStack, IndividualSearchContext& searchContext) :
 		m_Evaluator(evaluator),
 		m_PositionStack(positionStack),
-		m_SearchContext(searchContext)
+		m_SearchContext(searchContext),
+		m_TranspositionTable(static_cast<SharedSearchContext&>(searchContext).GetTranspositionTable())
 	{}
 
-	void MakeMoveUpdate(const Move& move)
+	void MakeMoveUpdate(const Move& move, const int64_t reduction = 0)
+	{
+		const Position& newPosition = m_PositionStack.MakeMove(move);
+		// the child probes the table as one of the first things it does, start loading the bucket right away
+		m_TranspositionTable.Prefetch(newPosition.Hash);
+		m_SearchContext.MakeMove(reduction);
+	}
+
+	// the null position's move list and accumulator are produced by the child like for any other move
+	template<Color sideToMove>
+	void MakeNullMoveUpdate(const int64_t reduction)
 	{
-		m_PositionStack.MakeMove(move);
-		m_SearchContext.MakeMove();
+		const Position& newPosition = m_PositionStack.MakeNullMove<sideToMove>();
+		m_TranspositionTable.Prefetch(newPosition.Hash);
+		m_SearchContext.MakeMove(reduction);
 	}
 
-	void UndoMoveUpdate()
+	void UndoMoveUpdate(const int64_t reduction = 0)
 	{
 		m_PositionStack.UndoMove();
-		m_SearchContext.UndoMove();
+		m_SearchContext.UndoMove(reduction);
 	}
 
-	template<Color sideToMove>
+	template<Color sideToMove, GenType genType = GenType::ALL>
 	const std::pair<MoveList&, MoveGenerationUpdateGuard> GenerateMoves()
 	{
-		auto& moveList = m_PositionStack.GetMoveList<sideToMove>();
+		auto& moveList = m_PositionStack.GetMoveList<sideToMove, genType>();
 
 		return std::pair<MoveList&, MoveGenerationUpdateGuard>( moveList, MoveGenerationUpdate<sideToMove>(moveList));
 	}
@@ -116,8 +157,97 @@ private:
 	Evaluator& m_Evaluator;
 	PositionStack& m_PositionStack;
 	IndividualSearchContext& m_SearchContext;
+	const TranspositionTable& m_TranspositionTable;
 };
 
+// resolves the captures left hanging at the horizon so that the static eval is only ever taken in a quiet position
+// the side to move may always stand pat instead of capturing, unless it is in check, in which case every evasion is searched
+template<Color sideToMove>
+inline Score QuiescenceSearch(AlphaBeta alphaBeta, PositionStack& positionStack, Evaluator& evaluator, IndividualSearchContext& searchContext)
+{
+	IncrementalUpdater incrementalUpdater(evaluator, positionStack, searchContext);
+
+	auto& nodes = searchContext.Nodes;
+	auto& cancellationPolicy = static_cast<SharedSearchContext&>(searchContext).GetCancellationPolicy();
+
+	constexpr Color oppositeSide = GetOppositeColor<sideToMove>();
+	const Position& position = positionStack.GetCurrentPosition();
+
+	// check for search aborted
+	if ((searchContext.Nodes & 0xFFF) == 0xFFF)
+		if (cancellationPolicy.CheckForAbort(nodes))
+			return Score::UNKNOWN;
+
+	// captures are irreversible, so only the draw rules that don't need the history can trigger here
+	if (position.IsDrawn())
+	{
+		nodes++;
+
+		const size_t randomSeed = nodes;
+		return GetDrawValueWithSmallVariance(randomSeed);
+	}
+
+	// the capture list still fills in the checkers and everything else the evaluator reads
+	[[maybe_unused]] const auto&& [moveList, guard] = incrementalUpdater.GenerateMoves<sideToMove, GenType::CAPTURES>();
+	const bool isInCheck = moveList.MoveListMisc.Checkers;
+
+	if (positionStack.GetDepth() >= int64_t(MAX_PLY) - 2)
+	{
+		nodes++;
+		return isInCheck ? evaluator.Evaluate<sideToMove>(positionStack.GetMoveList<sideToMove>(), searchContext.GetSearchDepth()) : evaluator.EvaluateStatic<sideToMove>();
+	}
+
+	if (isInCheck)
+	{
+		// regenerated in place, the evaluator keeps pointing at the same (identical) miscellaneous data
+		positionStack.GetMoveList<sideToMove>();
+		if (moveList.GetNumMoves() == 0)
+		{
+			nodes++;
+			return evaluator.Evaluate<sideToMove>(moveList, searchContext.GetSearchDepth());
+		}
+	}
+	else
+	{
+		const Score standPat = evaluator.EvaluateStatic<sideToMove>();
+		if (standPat >= alphaBeta.Beta || moveList.GetNumMoves() == 0)
+		{
+			nodes++;
+			return std::clamp(standPat, alphaBeta.Alpha, alphaBeta.Beta);
+		}
+		alphaBeta.Alpha = std::max(alphaBeta.Alpha, standPat);
+	}
+
+	const int64_t ply = searchContext.GetSearchDepth();
+	MovePicker<sideToMove> movePicker(position, moveList, NULL_MOVE.ToPackedMove(), searchContext.GetKillerMoves(), ply, searchContext.GetHistory());
+
+	while (const Move currentMove = movePicker.Next())
+	{
+		incrementalUpdater.MakeMoveUpdate(currentMove);
+		const Score score = -QuiescenceSearch<oppositeSide>(alphaBeta.Invert(), positionStack, evaluator, searchContext);
+		incrementalUpdater.UndoMoveUpdate();
+
+		if (cancellationPolicy.IsAborted())
+		{
+			return Score::UNKNOWN;
+		}
+
+		ValidateScore(score);
+
+		if (score > alphaBeta.Alpha)
+		{
+			if (score >= alphaBeta.Beta)
+			{
+				return alphaBeta.Beta;
+			}
+
+			alphaBeta.Alpha = score;
+		}
+	}
+
+	return alphaBeta.Alpha;
+}
+
 template<Color sideToMove, bool isRootNode = false>
 inline Score Search(AlphaBeta alphaBeta, PositionStack& positionStack, Evaluator& evaluator, IndividualSearchContext& searchContext)
 {
@@ -149,40 +279,111 @@ inline Score Search(AlphaBeta alphaBeta, PositionStack& positionStack, Evaluator
 	}
 
 	// is score in TT
-	if ((score = GetScoreFromTranspositionTable(position, alphaBeta, transpositionTable, searchContext.GetRemainingDepth())) != Score::UNKNOWN)
+	// the root is never cut off, a lazy smp helper might have already stored it at the depth the main thread is about to search
+	TranspositionTableEntry transpositionTableEntry;
+	const bool transpositionTableHit = transpositionTable.Probe(position.Hash, transpositionTableEntry);
+	if (!isRootNode && (score = GetScoreFromTranspositionTable(transpositionTableHit, transpositionTableEntry, alphaBeta, searchContext.GetRemainingDepth())) != Score::UNKNOWN)
 	{
 		nodes++;
 		ValidateScore(score);
 		return score;
 	}
 
+	if (searchContext.GetRemainingDepth() <= 0)
+	{
+		return QuiescenceSearch<sideToMove>(alphaBeta, positionStack, evaluator, searchContext);
+	}
+
 	// is leaf node for another reason
 	[[maybe_unused]] const auto&& [moveList, guard] = incrementalUpdater.GenerateMoves<sideToMove>();
 	
-	if (searchContext.GetRemainingDepth() == 0 || moveList.GetNumMoves() == 0)
+	if (moveList.GetNumMoves() == 0)
 	{
 		score = evaluator.Evaluate<sideToMove>(moveList, searchContext.GetSearchDepth());
 		ValidateScore(score);
 
-		const TranspositionTableEntry entry = { position.Hash, score, searchContext.GetRemainingDepth(), Move(), TTFlag::EXACT };
-		transpositionTable.Insert(entry, isRootNode);
+		const TranspositionTableEntry entry = { position.Hash, score, searchContext.GetRemainingDepth(), NULL_MOVE.ToPackedMove(), TTFlag::EXACT };
+		transpositionTable.Insert(entry, isRootNode && searchContext.IsMainThread());
 
 		nodes++;
 		return score;
 	}
 
+	const bool isInCheck = moveList.MoveListMisc.Checkers;
+	const bool isPvNode = alphaBeta.Beta != alphaBeta.Alpha + Score(1);
+	const int64_t remainingDepth = searchContext.GetRemainingDepth();
+
+	// null move pruning, if passing the turn still fails high then a real move almost certainly would as well
+	// not done in check (passing would be illegal) or without pieces, where zugzwang makes passing a real advantage
+	const Side& ownPieces = position.GetSide<sideToMove>();
+	const bool hasNonPawnMaterial = ownPieces.Knights | ownPieces.Bishops | ownPieces.Rooks | ownPieces.Queens;
+	if (!isRootNode && !isPvNode && !isInCheck && hasNonPawnMaterial && !positionStack.IsAfterNullMove() &&
+		remainingDepth >= NULL_MOVE_MIN_DEPTH && evaluator.EvaluateStatic<sideToMove>() >= alphaBeta.Beta)
+	{
+		const int64_t reduction = NULL_MOVE_BASE_REDUCTION + remainingDepth / 4;
+		const AlphaBeta nullWindow = { alphaBeta.Beta + Score(-1), alphaBeta.Beta };
+
+		incrementalUpdater.MakeNullMoveUpdate<sideToMove>(reduction);
+		score = -Search<oppositeSide>(nullWindow.Invert(), positionStack, evaluator, searchContext);
+		incrementalUpdater.UndoMoveUpdate(reduction);
+
+		if (cancellationPolicy.IsAborted())
+		{
+			return Score::UNKNOWN;
+		}
+
+		if (score >= alphaBeta.Beta)
+		{
+			return alphaBeta.Beta;
+		}
+	}
+
 	// no
 	TTFlag transpositionTableEntryFlag = TTFlag::ALPHA;
 	Move bestMove;
 	Score bestValue = Score::NEGATIVE_INF;
 
-	for (uint32_t moveIndex = 0; moveIndex < moveList.GetNumMoves(); moveIndex++)
+	const int64_t ply = searchContext.GetSearchDepth();
+	const KillerMoves& killerMoves = searchContext.GetKillerMoves();
+	const uint16_t transpositionTableMove = transpositionTableHit ? transpositionTableEntry.BestMove : NULL_MOVE.ToPackedMove();
+	MovePicker<sideToMove> movePicker(position, moveList, transpositionTableMove, searchContext.GetKillerMoves(), ply, searchContext.GetHistory());
+
+	uint32_t movesSearched = 0;
+	while (const Move currentMove = movePicker.Next())
 	{
-		const Move& currentMove = moveList[moveIndex];
+		// late move reductions, quiet moves this far down the ordering rarely turn out best so they get a shallower search first
+		int64_t reduction = 0;
+		const bool isQuiet = !currentMove.IsCapture() && !currentMove.IsPromotion();
+		if (isQuiet && !isInCheck && movesSearched >= LATE_MOVE_REDUCTION_MIN_MOVES && remainingDepth >= LATE_MOVE_REDUCTION_MIN_DEPTH &&
+			currentMove != killerMoves.Get(ply, 0) && currentMove != killerMoves.Get(ply, 1))
+		{
+			reduction = LATE_MOVE_REDUCTIONS[std::min<int64_t>(remainingDepth, 63)][std::min<uint32_t>(movesSearched, 63)];
+			reduction = std::clamp<int64_t>(reduction - int64_t(isPvNode), 0, remainingDepth - 1);
+		}
 
-		incrementalUpdater.MakeMoveUpdate(currentMove);
-		score = -Search<oppositeSide>(alphaBeta.Invert(), positionStack, evaluator, searchContext);
-		incrementalUpdater.UndoMoveUpdate();
+		incrementalUpdater.MakeMoveUpdate(currentMove, reduction);
+		// principal variation search, the first move is expected to be the best one so the rest are only tried with a zero window
+		// and searched again with the full window if one of them turns out to beat alpha after all
+		if (movesSearched == 0)
+		{
+			score = -Search<oppositeSide>(alphaBeta.Invert(), positionStack, evaluator, searchContext);
+		}
+		else
+		{
+			score = -Search<oppositeSide>(alphaBeta.ZeroWindow().Invert(), positionStack, evaluator, searchContext);
+			if (reduction != 0 && score > alphaBeta.Alpha && !cancellationPolicy.IsAborted())
+			{
+				// the reduced search could not refute the move, it has to be looked at with the full depth
+				incrementalUpdater.UndoMoveUpdate(reduction);
+				reduction = 0;
+				incrementalUpdater.MakeMoveUpdate(currentMove);
+				score = -Search<oppositeSide>(alphaBeta.ZeroWindow().Invert(), positionStack, evaluator, searchContext);
+			}
+			if (score > alphaBeta.Alpha && score < alphaBeta.Beta && !cancellationPolicy.IsAborted())
+				score = -Search<oppositeSide>(alphaBeta.Invert(), positionStack, evaluator, searchContext);
+		}
+		incrementalUpdater.UndoMoveUpdate(reduction);
+		movesSearched++;
 
 		if (cancellationPolicy.IsAborted())
 		{
@@ -201,8 +402,14 @@ inline Score Search(AlphaBeta alphaBeta, PositionStack& positionStack, Evaluator
 		{
 			if (score >= alphaBeta.Beta)
 			{
-				const TranspositionTableEntry entry = { position.Hash, score, searchContext.GetRemainingDepth(), bestMove, TTFlag::BETA };
-				transpositionTable.Insert(entry, isRootNode);
+				if (isQuiet)
+				{
+					searchContext.GetKillerMoves().Add(ply, currentMove);
+					searchContext.GetHistory().Update<sideToMove>(currentMove, int32_t(remainingDepth * remainingDepth));
+				}
+
+				const TranspositionTableEntry entry = { position.Hash, score, searchContext.GetRemainingDepth(), bestMove.ToPackedMove(), TTFlag::BETA };
+				transpositionTable.Insert(entry, isRootNode && searchContext.IsMainThread());
 
 				return alphaBeta.Beta;
 			}
@@ -212,26 +419,56 @@ inline Score Search(AlphaBeta alphaBeta, PositionStack& positionStack, Evaluator
 		}
 	}
 
-	const TranspositionTableEntry entry = { position.Hash, score, searchContext.GetRemainingDepth(), bestMove, transpositionTableEntryFlag };
-	transpositionTable.Insert(entry, isRootNode);
+	const TranspositionTableEntry entry = { position.Hash, alphaBeta.Alpha, searchContext.GetRemainingDepth(), bestMove.ToPackedMove(), transpositionTableEntryFlag };
+	transpositionTable.Insert(entry, isRootNode && searchContext.IsMainThread());
 
 	return alphaBeta.Alpha;
 }
 
+// searches the root in a window around the previous iteration's score, which is where the new score usually lands
+// whichever bound the score fails on is pushed out by a growing margin until it falls inside the window
+template<Color color>
+forceinline Score AspirationSearch(PositionStack& positionStack, Evaluator& evaluator, IndividualSearchContext& searchContext, const Score previousScore)
+{
+	if (searchContext.GetRemainingDepth() < ASPIRATION_MIN_DEPTH)
+		return Search<color, true>({ Score::NEGATIVE_INF, Score::POSITIVE_INF }, positionStack, evaluator, searchContext);
+
+	int32_t margin = ASPIRATION_INITIAL_MARGIN;
+	Score alpha = std::max(previousScore + Score(-margin), Score::NEGATIVE_INF);
+	Score beta = std::min(previousScore + Score(margin), Score::POSITIVE_INF);
+
+	while (true)
+	{
+		const Score score = Search<color, true>({ alpha, beta }, positionStack, evaluator, searchContext);
+		if (static_cast<SharedSearchContext&>(searchContext).GetCancellationPolicy().IsAborted())
+			return score;
+
+		margin *= 2;
+		if (score <= alpha && alpha != Score::NEGATIVE_INF)
+			alpha = std::max(alpha + Score(-margin), Score::NEGATIVE_INF);
+		else if (score >= beta && beta != Score::POSITIVE_INF)
+			beta = std::min(beta + Score(margin), Score::POSITIVE_INF);
+		else
+			return score;
+	}
+}
+
 template<Color color, bool showOutput>
 forceinline std::vector<SearchResult> IterativeDeepening(PositionStack& positionStack, Evaluator& evaluator, SharedSearchContext& searchContext)
 {
 	std::vector<SearchResult> searchResults;
+	std::unique_ptr<ButterflyHistory> history = std::make_unique<ButterflyHistory>();
 
 	for (int64_t depth = 1; depth <= searchContext.GetSearchDepth(); depth++)
 	{
 		const Position& rootPos = positionStack.GetCurrentPosition();
+		const size_t helperNodesBefore = searchContext.GetHelperNodes();
 
-		AlphaBeta alphaBeta = { Score::NEGATIVE_INF, Score::POSITIVE_INF }; 
-		IndividualSearchContext individualSearchContext = IndividualSearchContext(searchContext, depth);
+		IndividualSearchContext individualSearchContext = IndividualSearchContext(searchContext, *history, depth);
+		const Score previousScore = searchResults.empty() ? Score::DRAW : searchResults.back().Score;
 
 		auto startTimepoint = std::chrono::high_resolution_clock::now();
-		const auto score = Search<color, true>(alphaBeta, positionStack, evaluator, individualSearchContext);
+		const auto score = AspirationSearch<color>(positionStack, evaluator, individualSearchContext, previousScore);
 		auto endTimepoint = std::chrono::high_resolution_clock::now();
 		size_t duration = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(endTimepoint - startTimepoint).count();
 
@@ -241,7 +478,7 @@ forceinline std::vector<SearchResult> IterativeDeepening(PositionStack& position
 		}
 
 		SearchResult result;
-		result.Nodes = individualSearchContext.Nodes;
+		result.Nodes = individualSearchContext.Nodes + (searchContext.GetHelperNodes() - helperNodesBefore);
 		result.Score = score;
 		result.Depth = depth;
 
@@ -250,15 +487,15 @@ forceinline std::vector<SearchResult> IterativeDeepening(PositionStack& position
 		for (int pvDepth = 0; pvDepth < depth; pvDepth++)
 		{
 			MoveList currentPositionMoves = GenerateMoves(currentPosition, *rootMoveList);
-			const auto& currentTranspositionTableEntry = searchContext.GetTranspositionTable().Get(currentPosition.Hash);
+			TranspositionTableEntry currentTranspositionTableEntry;
 
-			if (currentTranspositionTableEntry.BestMove.FromBitmask() == 0 && currentTranspositionTableEntry.BestMove.ToBitmask() == 0)
+			if (!searchContext.GetTranspositionTable().Probe(currentPosition.Hash, currentTranspositionTableEntry))
 				break;
 			for (uint32_t moveIndex = 0; moveIndex < currentPositionMoves.GetNumMoves(); moveIndex++)
 			{
-				if (currentPositionMoves[moveIndex] == currentTranspositionTableEntry.BestMove)
+				if (currentPositionMoves[moveIndex].ToPackedMove() == currentTranspositionTableEntry.BestMove)
 				{
-					result.Pv[pvDepth] = currentTranspositionTableEntry.BestMove;
+					result.Pv[pvDepth] = currentPositionMoves[moveIndex];
 					result.PvLength++;
 					Position newPosition;
 					Position::MakeMove(currentPosition, newPosition, result.Pv[pvDepth]);
@@ -280,6 +517,95 @@ forceinline std::vector<SearchResult> IterativeDeepening(PositionStack& position
 	return searchResults;
 }
 
+// lazy smp helper, searches the same root as the main thread and only communicates through the transposition table
+// odd helpers start one ply deeper so that the threads don't all walk the same tree in lockstep
+template<Color color>
+forceinline void HelperIterativeDeepening(PositionStack& positionStack, Evaluator& evaluator, SharedSearchContext& searchContext, const size_t threadIndex)
+{
+	std::unique_ptr<ButterflyHistory> history = std::make_unique<ButterflyHistory>();
+	Score previousScore = Score::DRAW;
+
+	for (int64_t depth = 1 + int64_t(threadIndex & 1); depth <= searchContext.GetSearchDepth(); depth++)
+	{
+		IndividualSearchContext individualSearchContext = IndividualSearchContext(searchContext, *history, depth, threadIndex);
+
+		previousScore = AspirationSearch<color>(positionStack, evaluator, individualSearchContext, previousScore);
+		searchContext.AddHelperNodes(individualSearchContext.Nodes);
+
+		if (searchContext.GetCancellationPolicy().IsAborted())
+		{
+			break;
+		}
+	}
+}
+
+forceinline void HelperSearchThreadFunction(SearchThreadState& threadState, SharedSearchContext& searchContext, const size_t threadIndex)
+{
+	try
+	{
+		if (threadState.ThreadPositionStack.GetCurrentPosition().SideToMove == Color::WHITE)
+		{
+			HelperIterativeDeepening<Color::WHITE>(threadState.ThreadPositionStack, threadState.ThreadEvaluator, searchContext, threadIndex);
+		}
+		else
+		{
+			HelperIterativeDeepening<Color::BLACK>(threadState.ThreadPositionStack, threadState.ThreadEvaluator, searchContext, threadIndex);
+		}
+	}
+	catch (...)
+	{
+		threadState.Exception = std::current_exception();
+		searchContext.GetCancellationPolicy().Abort();
+	}
+}
+
+template<bool showOutput>
+forceinline std::vector<SearchResult> StartSearch(PositionStack& positionStack, Evaluator& evaluator, SharedSearchContext& searchContext, SearchHelpers& searchHelpers)
+{
+	std::vector<std::thread> helperThreads;
+	helperThreads.reserve(searchHelpers.size());
+
+	for (size_t helperIndex = 0; helperIndex < searchHelpers.size(); helperIndex++)
+	{
+		SearchThreadState& threadState = *searchHelpers[helperIndex];
+		threadState.ThreadPositionStack = positionStack;
+		threadState.ThreadEvaluator.Reset(threadState.ThreadPositionStack);
+		threadState.Exception = nullptr;
+
+		// thread index 0 is reserved for the main thread
+		helperThreads.emplace_back(HelperSearchThreadFunction, std::ref(threadState), std::ref(searchContext), helperIndex + 1);
+	}
+
+	std::vector<SearchResult> results;
+	std::exception_ptr mainThreadException;
+	try
+	{
+		results = StartSearch<showOutput>(positionStack, evaluator, searchContext);
+	}
+	catch (...)
+	{
+		mainThreadException = std::current_exception();
+	}
+
+	// helpers that started on an odd depth may still be busy, the search is over once the main thread is done
+	searchContext.GetCancellationPolicy().Abort();
+	for (auto& helperThread : helperThreads)
+	{
+		helperThread.join();
+	}
+
+	if (mainThreadException)
+		std::rethrow_exception(mainThreadException);
+
+	for (const auto& threadState : searchHelpers)
+	{
+		if (threadState->Exception)
+			std::rethrow_exception(threadState->Exception);
+	}
+
+	return results;
+}
+
 template<bool showOutput>
 forceinline std::vector<SearchResult> StartSearch(PositionStack& positionStack, Evaluator& evaluator, SharedSearchContext& searchContext)
 {
@@ -0,0 +1,37 @@
+#pragma once
+#include "Core/Engine/utils.h"
+#include "Eval/evaluator.h"
+#include "Search/position_stack.h"
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// state owned by a single lazy smp helper thread
+// everything that gets mutated during search lives here, only the transposition table
+// and the cancellation policy are shared with the other threads through SharedSearchContext
+struct SearchThreadState
+{
+	forceinline SearchThreadState(const std::string_view& weightsFilename) :
+		ThreadPositionStack{},
+		ThreadEvaluator(weightsFilename),
+		Exception{}
+	{
+	}
+
+	PositionStack ThreadPositionStack;
+	Evaluator ThreadEvaluator;
+	std::exception_ptr Exception;
+};
+
+using SearchHelpers = std::vector<std::unique_ptr<SearchThreadState>>;
+
+forceinline void ResizeSearchHelpers(SearchHelpers& helpers, const size_t numHelpers, const std::string_view& weightsFilename)
+{
+	helpers.resize(std::min(helpers.size(), numHelpers));
+	while (helpers.size() < numHelpers)
+	{
+		helpers.push_back(std::make_unique<SearchThreadState>(weightsFilename));
+	}
+}
@@ -2,57 +2,333 @@
 #include "Chess/move.h"
 #include "Core/Engine/utils.h"
 #include "Eval/score.h"
+#include "Hardware/architecture.h"
+#include "Hardware/mapped_file.h"
+#include "Hardware/memory.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
-enum class TTFlag
+enum class TTFlag : uint8_t
 {
 	EXACT,
 	ALPHA,
 	BETA
 };
 
+// unpacked view of a transposition table slot, this is what the search works with
+// BestMove is stored in its packed 16 bit form, see Move::ToPackedMove
 struct TranspositionTableEntry
 {
 	uint64_t Key = 0;
 	Score Score = Score::DRAW;
 	int64_t Depth = 0;
-	Move BestMove;
+	uint16_t BestMove = 0;
 	TTFlag Flag = TTFlag::EXACT;
 };
 
+// a single 16 byte slot, the data word is stored twice: once as is and once xored into the key
+// a reader that sees a data word from one write and a key from another will fail the key check,
+// which makes torn reads/writes from other search threads harmless without any locking
+struct PackedTranspositionTableEntry
+{
+	// data layout (LSB first): score 16 | move 16 | depth 8 | bound 2, generation 6 | unused 16
+	inline static constexpr uint64_t SCORE_OFFSET = 0;
+	inline static constexpr uint64_t MOVE_OFFSET = SCORE_OFFSET + 16;
+	inline static constexpr uint64_t DEPTH_OFFSET = MOVE_OFFSET + 16;
+	inline static constexpr uint64_t BOUND_OFFSET = DEPTH_OFFSET + 8;
+	inline static constexpr uint64_t GENERATION_OFFSET = BOUND_OFFSET + 2;
+
+	inline static constexpr uint64_t MAX_STORED_DEPTH = 0xFF;
+	inline static constexpr uint64_t GENERATION_MASK = 0b111111;
+
+	forceinline static constexpr uint64_t Pack(const TranspositionTableEntry& entry, const uint8_t generation);
+	forceinline static constexpr TranspositionTableEntry Unpack(const uint64_t key, const uint64_t data);
+	forceinline static constexpr int64_t UnpackDepth(const uint64_t data) { return int64_t((data >> DEPTH_OFFSET) & 0xFF); }
+	forceinline static constexpr uint8_t UnpackGeneration(const uint64_t data) { return uint8_t((data >> GENERATION_OFFSET) & GENERATION_MASK); }
+
+	std::atomic<uint64_t> XoredKey;
+	std::atomic<uint64_t> Data;
+};
+
+struct alignas(CACHE_LINE_SIZE) TranspositionTableBucket
+{
+	inline static constexpr size_t ENTRIES_PER_BUCKET = CACHE_LINE_SIZE / sizeof(PackedTranspositionTableEntry);
+
+	PackedTranspositionTableEntry Entries[ENTRIES_PER_BUCKET];
+};
+static_assert(sizeof(PackedTranspositionTableEntry) == 16);
+static_assert(sizeof(TranspositionTableBucket) == CACHE_LINE_SIZE);
+
+// a dumped table is this header followed by the raw buckets, the header is padded to a cache line
+// so that the buckets in a mapped file keep their alignment
+struct alignas(CACHE_LINE_SIZE) TranspositionTableFileHeader
+{
+	inline static constexpr uint64_t MAGIC = 0x5454414E494E; // "NINATT"
+	// bump whenever the packed entry layout changes, old dumps are then rejected on load
+	inline static constexpr uint32_t VERSION = 2;
+
+	uint64_t Magic = MAGIC;
+	uint32_t Version = VERSION;
+	uint32_t EntrySize = sizeof(PackedTranspositionTableEntry);
+	uint64_t SizeInMb = 0;
+	uint64_t BucketCount = 0;
+	uint8_t Generation = 0;
+};
+static_assert(sizeof(TranspositionTableFileHeader) == CACHE_LINE_SIZE);
+
 class TranspositionTable
 {
 public:
-	forceinline TranspositionTable(const size_t sizeInMb);
+	forceinline TranspositionTable(const size_t sizeInMb, const size_t numClearThreads = 1);
+
+	forceinline void Clear(const size_t numThreads = 1);
+	forceinline void Dump(const std::string_view& filename) const;
+	forceinline constexpr size_t GetSizeInMb() const { return m_SizeInMb; }
+	forceinline constexpr bool IsOnLargePages() const { return m_IsOnLargePages; }
+	forceinline void Insert(const TranspositionTableEntry& entry, const bool forceOverwrite);
+	// called once per search, entries written by older searches become the preferred replacement victims
+	forceinline constexpr void NewSearch() { m_Generation = (m_Generation + 1) & PackedTranspositionTableEntry::GENERATION_MASK; }
+	// pulls the bucket of a position into cache ahead of the probe, the whole bucket is a single cache line
+	forceinline void Prefetch(const uint64_t key) const { _mm_prefetch(reinterpret_cast<const char*>(&getBucket(key)), _MM_HINT_T0); }
+	forceinline bool Probe(const uint64_t key, TranspositionTableEntry& entry) const;
 
-	forceinline constexpr void Insert(const TranspositionTableEntry& entry, const bool forceOverwrite);
-	forceinline constexpr const TranspositionTableEntry& Get(const uint64_t key) const;
+	forceinline static std::unique_ptr<TranspositionTable> Load(const std::string_view& filename, const size_t numThreads = 1);
 
 private:
-	std::vector<TranspositionTableEntry> m_Entries;
+	struct UninitializedTag {};
+	forceinline TranspositionTable(const size_t sizeInMb, UninitializedTag);
+
+	// every search that passed since the entry was written costs it this much depth when picking what to replace
+	inline static constexpr int64_t AGE_DEPTH_PENALTY = 4;
+
+	forceinline void clearBuckets(const size_t firstBucket, const size_t lastBucket);
+	template<typename BucketRangeFunction>
+	forceinline void forEachBucketRange(const size_t numThreads, const BucketRangeFunction& function);
+	forceinline constexpr int64_t getAge(const uint64_t data) const;
+	forceinline static constexpr size_t getBucketCount(const size_t sizeInMb);
+	forceinline constexpr size_t getSizeInBytes() const { return m_BucketCount * sizeof(TranspositionTableBucket); }
+	forceinline TranspositionTableBucket& getBucket(const uint64_t key) const { return m_Buckets[FastModulo(key, m_BucketCount)]; }
+
+	std::unique_ptr<TranspositionTableBucket[], LargePageDeleter> m_Buckets;
+	size_t m_BucketCount;
+	size_t m_SizeInMb;
+	bool m_IsOnLargePages;
+	uint8_t m_Generation;
 };
 
-forceinline TranspositionTable::TranspositionTable(const size_t sizeInMb)
+forceinline constexpr uint64_t PackedTranspositionTableEntry::Pack(const TranspositionTableEntry& entry, const uint8_t generation)
+{
+	const uint64_t depth = uint64_t(std::clamp(entry.Depth, int64_t(0), int64_t(MAX_STORED_DEPTH)));
+
+	return (uint64_t(uint16_t(int16_t(entry.Score))) << SCORE_OFFSET) |
+		(uint64_t(entry.BestMove) << MOVE_OFFSET) |
+		(depth << DEPTH_OFFSET) |
+		(uint64_t(entry.Flag) << BOUND_OFFSET) |
+		(uint64_t(generation & GENERATION_MASK) << GENERATION_OFFSET);
+}
+
+forceinline constexpr TranspositionTableEntry PackedTranspositionTableEntry::Unpack(const uint64_t key, const uint64_t data)
+{
+	TranspositionTableEntry entry;
+	entry.Key = key;
+	entry.Score = Score(int16_t(uint16_t(data >> SCORE_OFFSET)));
+	entry.BestMove = uint16_t(data >> MOVE_OFFSET);
+	entry.Depth = UnpackDepth(data);
+	entry.Flag = TTFlag((data >> BOUND_OFFSET) & 0b11);
+	return entry;
+}
+
+forceinline TranspositionTable::TranspositionTable(const size_t sizeInMb, const size_t numClearThreads) :
+	TranspositionTable(sizeInMb, UninitializedTag{})
+{
+	// the memory is untouched up to this point, so the clear is also what actually faults the pages in
+	Clear(numClearThreads);
+}
+
+forceinline TranspositionTable::TranspositionTable(const size_t sizeInMb, UninitializedTag) :
+	m_SizeInMb(sizeInMb),
+	m_Generation(0)
+{
+	m_BucketCount = getBucketCount(sizeInMb);
+
+	void* memory = AllocateLargePages(getSizeInBytes(), m_IsOnLargePages);
+	m_Buckets = std::unique_ptr<TranspositionTableBucket[], LargePageDeleter>(static_cast<TranspositionTableBucket*>(memory));
+	InterleaveAcrossNumaNodes(memory, getSizeInBytes());
+}
+
+forceinline void TranspositionTable::Clear(const size_t numThreads)
+{
+	m_Generation = 0;
+
+	forEachBucketRange(numThreads, [this](const size_t firstBucket, const size_t lastBucket)
+		{
+			clearBuckets(firstBucket, lastBucket);
+		});
+}
+
+template<typename BucketRangeFunction>
+forceinline void TranspositionTable::forEachBucketRange(const size_t numThreads, const BucketRangeFunction& function)
+{
+	if (numThreads <= 1)
+	{
+		function(size_t(0), m_BucketCount);
+		return;
+	}
+
+	std::vector<std::thread> workerThreads;
+	workerThreads.reserve(numThreads);
+	const size_t bucketsPerThread = (m_BucketCount + numThreads - 1) / numThreads;
+	for (size_t threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		const size_t firstBucket = std::min(threadIndex * bucketsPerThread, m_BucketCount);
+		const size_t lastBucket = std::min(firstBucket + bucketsPerThread, m_BucketCount);
+		workerThreads.emplace_back(function, firstBucket, lastBucket);
+	}
+	for (auto& workerThread : workerThreads)
+	{
+		workerThread.join();
+	}
+}
+
+forceinline void TranspositionTable::Dump(const std::string_view& filename) const
+{
+	std::ofstream file(std::string(filename), std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("could not open " + std::string(filename) + " for writing");
+
+	TranspositionTableFileHeader header;
+	header.SizeInMb = m_SizeInMb;
+	header.BucketCount = m_BucketCount;
+	header.Generation = m_Generation;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_Buckets.get()), getSizeInBytes());
+
+	if (!file)
+		throw std::runtime_error("failed writing the transposition table to " + std::string(filename));
+}
+
+forceinline std::unique_ptr<TranspositionTable> TranspositionTable::Load(const std::string_view& filename, const size_t numThreads)
+{
+	const MappedFile mappedFile(filename);
+
+	TranspositionTableFileHeader header;
+	if (mappedFile.GetSize() < sizeof(header))
+		throw std::runtime_error(std::string(filename) + " is not a transposition table dump");
+	std::memcpy(&header, mappedFile.GetData(), sizeof(header));
+
+	if (header.Magic != TranspositionTableFileHeader::MAGIC)
+		throw std::runtime_error(std::string(filename) + " is not a transposition table dump");
+	if (header.Version != TranspositionTableFileHeader::VERSION || header.EntrySize != sizeof(PackedTranspositionTableEntry))
+		throw std::runtime_error(std::string(filename) + " was dumped with a different entry format");
+
+	// the header is checked against the file before anything is allocated, a corrupted size would otherwise be allocated first
+	const size_t numDumpedBuckets = (mappedFile.GetSize() - sizeof(header)) / sizeof(TranspositionTableBucket);
+	if (header.SizeInMb == 0 || header.SizeInMb > numDumpedBuckets * sizeof(TranspositionTableBucket) / (1024 * 1024) + 1 ||
+		getBucketCount(header.SizeInMb) != header.BucketCount ||
+		mappedFile.GetSize() != sizeof(header) + header.BucketCount * sizeof(TranspositionTableBucket))
+		throw std::runtime_error(std::string(filename) + " is truncated or corrupted");
+
+	std::unique_ptr<TranspositionTable> transpositionTable(new TranspositionTable(header.SizeInMb, UninitializedTag{}));
+
+	// copying straight out of the mapping in parallel, the kernel reads the file in as the threads touch it
+	const uint8_t* dumpedBuckets = mappedFile.GetData() + sizeof(header);
+	auto& buckets = transpositionTable->m_Buckets;
+	transpositionTable->forEachBucketRange(numThreads, [&buckets, dumpedBuckets](const size_t firstBucket, const size_t lastBucket)
+		{
+			std::memcpy(static_cast<void*>(&buckets[firstBucket]), dumpedBuckets + firstBucket * sizeof(TranspositionTableBucket),
+				(lastBucket - firstBucket) * sizeof(TranspositionTableBucket));
+		});
+	transpositionTable->m_Generation = header.Generation;
+
+	return transpositionTable;
+}
+
+forceinline void TranspositionTable::clearBuckets(const size_t firstBucket, const size_t lastBucket)
+{
+	for (size_t bucketIndex = firstBucket; bucketIndex < lastBucket; bucketIndex++)
+	{
+		new (&m_Buckets[bucketIndex]) TranspositionTableBucket{};
+	}
+}
+
+forceinline constexpr size_t TranspositionTable::getBucketCount(const size_t sizeInMb)
 {
-	const size_t sizeInBytes = sizeInMb * 1024 * 1024;
-	const size_t entryCount = sizeInBytes / sizeof(TranspositionTableEntry);
-	m_Entries.resize(entryCount);
+	return std::max(sizeInMb * 1024 * 1024 / sizeof(TranspositionTableBucket), size_t(1));
 }
 
-forceinline constexpr void TranspositionTable::Insert(const TranspositionTableEntry& entry, const bool forceOverwrite)
+forceinline constexpr int64_t TranspositionTable::getAge(const uint64_t data) const
 {
-	const size_t index = FastModulo(entry.Key, m_Entries.size());
+	return (m_Generation - PackedTranspositionTableEntry::UnpackGeneration(data)) & PackedTranspositionTableEntry::GENERATION_MASK;
+}
 
-	const auto& currrentEntry = m_Entries[index];
-	if ((currrentEntry.Depth <= entry.Depth) || forceOverwrite)
+forceinline void TranspositionTable::Insert(const TranspositionTableEntry& entry, const bool forceOverwrite)
+{
+	auto& bucket = getBucket(entry.Key);
+
+	// an empty slot or one holding the same position is taken first,
+	// otherwise the entry with the lowest depth after the age penalty gets replaced
+	PackedTranspositionTableEntry* replacedSlot = &bucket.Entries[0];
+	int64_t replacedWorth = std::numeric_limits<int64_t>::max();
+	for (auto& slot : bucket.Entries)
 	{
-		m_Entries[index] = entry;
+		const uint64_t data = slot.Data.load(std::memory_order_relaxed);
+		const uint64_t slotKey = slot.XoredKey.load(std::memory_order_relaxed) ^ data;
+
+		if (slotKey == entry.Key)
+		{
+			// a deeper entry from the current search is kept, a deeper one from an older search is stale
+			if (PackedTranspositionTableEntry::UnpackDepth(data) > entry.Depth && getAge(data) == 0 && !forceOverwrite)
+				return;
+
+			replacedSlot = &slot;
+			break;
+		}
+
+		if (data == 0)
+		{
+			replacedSlot = &slot;
+			replacedWorth = std::numeric_limits<int64_t>::min();
+			continue;
+		}
+
+		const int64_t slotWorth = PackedTranspositionTableEntry::UnpackDepth(data) - AGE_DEPTH_PENALTY * getAge(data);
+		if (slotWorth < replacedWorth)
+		{
+			replacedSlot = &slot;
+			replacedWorth = slotWorth;
+		}
 	}
+
+	const uint64_t data = PackedTranspositionTableEntry::Pack(entry, m_Generation);
+	replacedSlot->XoredKey.store(entry.Key ^ data, std::memory_order_relaxed);
+	replacedSlot->Data.store(data, std::memory_order_relaxed);
 }
 
-forceinline constexpr const TranspositionTableEntry& TranspositionTable::Get(const uint64_t key) const
+forceinline bool TranspositionTable::Probe(const uint64_t key, TranspositionTableEntry& entry) const
 {
-	const size_t index = FastModulo(key, m_Entries.size());
+	const auto& bucket = getBucket(key);
 
-	return m_Entries[index];
+	for (const auto& slot : bucket.Entries)
+	{
+		const uint64_t data = slot.Data.load(std::memory_order_relaxed);
+		if ((slot.XoredKey.load(std::memory_order_relaxed) ^ data) == key)
+		{
+			entry = PackedTranspositionTableEntry::Unpack(key, data);
+			return true;
+		}
+	}
+	return false;
 }
@@ -45,5 +45,23 @@ int main()
 	}
 
 	std::cout << nps / numSearchBenchRuns << std::endl;
+
+	// same search, but with a table big enough that nearly every probe misses the cache and the TLB
+	// this is the case transposition table prefetching is meant for
+	constexpr size_t largeHashSizeInMb = 1024;
+	nps = 0;
+	for (uint32_t runIndex = 0; runIndex < numSearchBenchRuns; runIndex++)
+	{
+		size_t currRunNps = TestSearch(hideSearchTestOutput, benchDepthLimit, largeHashSizeInMb);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		nps += currRunNps;
+	}
+
+	std::cout << nps / numSearchBenchRuns << std::endl;
+
+	// not a speed, lower is better, so it comes after all the speed metrics that the benchmark script compares
+	constexpr int branchingFactorSearchDepth = 5;
+	std::cout << TestBranchingFactor(hideSearchTestOutput, branchingFactorSearchDepth) << std::endl;
 }
 #endif
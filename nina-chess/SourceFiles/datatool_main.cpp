@@ -0,0 +1,106 @@
+#ifdef _DATATOOL
+
+#include "GameGeneration/data_shuffle.h"
+#include "GameGeneration/data_tool.h"
+#include "GameGeneration/packed_data.h"
+#include "GameGeneration/rescore.h"
+#include "GameGeneration/shard_set.h"
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// datatool <count|validate|stats> [--threads n] <files...>
+// datatool shuffle [--threads n] [--memory mb] [--seed s] [--temp dir] --output out.bin <files...>
+// datatool <pack|unpack> [--threads n] --output out <files...>
+// datatool merge --output out data.bin.shards
+// datatool rescore [--weights file] --output out.bin <files...>
+// a gamegen shard set manifest (data.bin.shards) can be given anywhere files are, it stands for all of its shards
+int main(const int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: datatool <count|validate|stats> [--threads n] <files...>\n"
+			<< "       datatool shuffle [--threads n] [--memory mb] [--seed s] [--temp dir] --output out.bin <files...>\n"
+			<< "       datatool <pack|unpack> [--threads n] --output out <files...>\n"
+			<< "       datatool merge --output out data.bin.shards\n"
+			<< "       datatool rescore [--weights file] --output out.bin <files...>" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		const std::string command = argv[1];
+		size_t numThreads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+		std::vector<std::string> files;
+		std::string weightsFile = "weights";
+		DataShuffleSettings shuffleSettings;
+		shuffleSettings.Seed = std::random_device{}();
+
+		for (int argIndex = 2; argIndex < argc; argIndex++)
+		{
+			const std::string arg = argv[argIndex];
+			if (arg == "--threads" && argIndex + 1 < argc)
+				numThreads = std::stoul(argv[++argIndex]);
+			else if (arg == "--memory" && argIndex + 1 < argc)
+				shuffleSettings.MemoryBudgetMB = std::stoul(argv[++argIndex]);
+			else if (arg == "--seed" && argIndex + 1 < argc)
+				shuffleSettings.Seed = std::stoull(argv[++argIndex]);
+			else if (arg == "--temp" && argIndex + 1 < argc)
+				shuffleSettings.TempDirectory = argv[++argIndex];
+			else if (arg == "--weights" && argIndex + 1 < argc)
+				weightsFile = argv[++argIndex];
+			else if (arg == "--output" && argIndex + 1 < argc)
+				shuffleSettings.OutputFile = argv[++argIndex];
+			else
+				files.push_back(arg);
+		}
+
+		if (command == "merge")
+		{
+			if (shuffleSettings.OutputFile.empty() || files.size() != 1 || !ShardSetManifest::IsManifestFile(files[0]))
+				throw std::runtime_error("merge needs an output file and a single shard set manifest");
+			MergeShardSet(files[0], shuffleSettings.OutputFile);
+			return 0;
+		}
+		files = ExpandShardSets(files, command == "unpack");
+
+		if (command == "shuffle")
+		{
+			shuffleSettings.InputFiles = files;
+			shuffleSettings.NumThreads = numThreads ? numThreads : 1;
+			RunDataShuffle(shuffleSettings);
+			return 0;
+		}
+
+		if (command == "rescore")
+		{
+			if (shuffleSettings.OutputFile.empty())
+				throw std::runtime_error("rescore needs an output file");
+			RescorePositionEntryFiles(files, shuffleSettings.OutputFile, weightsFile);
+			return 0;
+		}
+
+		if (command == "pack" || command == "unpack")
+		{
+			if (shuffleSettings.OutputFile.empty())
+				throw std::runtime_error(command + " needs an output file");
+			if (command == "pack")
+				PackPositionEntries(files, shuffleSettings.OutputFile, numThreads ? numThreads : 1);
+			else
+				UnpackPositionEntries(files, shuffleSettings.OutputFile, numThreads ? numThreads : 1);
+			return 0;
+		}
+
+		return RunDataTool(command, files, numThreads ? numThreads : 1);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "Error: " << exception.what() << std::endl;
+		return 1;
+	}
+}
+
+#endif
@@ -37,6 +37,26 @@ inline GameGenerationSettings ParseArgs(const int argc, char* argv[])
 			settings.ScoreBySearchEval = (value == "eval");
 		else if (arg == "--output")
 			settings.OutputFile = value;
+		else if (arg == "--packed")
+			settings.PackedOutput = (value == "true" || value == "1");
+		else if (arg == "--shards")
+			settings.ShardedOutput = (value == "true" || value == "1");
+		else if (arg == "--resume")
+			settings.Resume = (value == "true" || value == "1");
+		else if (arg == "--checkpoint-interval")
+			settings.CheckpointIntervalSeconds = std::stoi(value);
+		else if (arg == "--seed")
+			settings.Seed = std::stoull(value);
+		else if (arg == "--win-adjudication-plies")
+			settings.WinAdjudicationPlies = std::stoi(value);
+		else if (arg == "--win-adjudication-score")
+			settings.WinAdjudicationScore = std::stoi(value);
+		else if (arg == "--draw-adjudication-plies")
+			settings.DrawAdjudicationPlies = std::stoi(value);
+		else if (arg == "--draw-adjudication-score")
+			settings.DrawAdjudicationScore = std::stoi(value);
+		else if (arg == "--draw-adjudication-start")
+			settings.DrawAdjudicationStartPly = std::stoi(value);
 		else if (arg == "--book")
 			settings.BookFile = value;
 		else if (arg == "--book-ply")
@@ -1,19 +1,40 @@
 #include "Core/Build/targets.h"
 #ifdef _TEST
 #include "NN/dense_layer_test.h"
+#include "NN/quantization_test.h"
+#include "Eval/evaluator_test.h"
+#include "GameGeneration/data_shuffle_test.h"
 #include "GameGeneration/game_generation_test.h"
+#include "MoveGen/move_gen_test.h"
 #include "Search/perft.h"
 
 int main()
 {
 	if (!TestDenseLayer())
 		return 1;
+	if (!TestQuantization())
+		return 1;
+	if (!TestEvaluateBatch())
+		return 1;
 	if (!TestPerft(false, _PERFTNODES))
 		return 1;
+	// the threaded, bulk counting and hashed path the perft command uses
+	if (!TestPerftSuite(4, 16, _PERFTNODES))
+		return 1;
+	if (!TestCaptureGeneration())
+		return 1;
 	if (!TestSearch(false))
 		return 1;
+	if (!TestDataShuffle())
+		return 1;
+	if (!TestGameAdjudication())
+		return 1;
 	if (!TestGameGeneration())
 		return 1;
+	if (!TestShardedGameGeneration())
+		return 1;
+	if (!TestResumedGameGeneration())
+		return 1;
 }
 
 #endif
@@ -9,12 +9,17 @@
 #include "Eval/evaluator.h"
 #include "MoveGen/move_gen.h"
 #include "Chess/position.h"
+#include "Search/perft.h"
 #include "Search/search.h"
+#include "Search/search_thread.h"
 #include "Search/transposition_table.h"
+#include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -39,6 +44,9 @@ struct UciDefaultSettings
 	inline static constexpr uint64_t HashSize = 16;
 	inline static constexpr uint64_t MinimalHashSize = 1;
 	inline static constexpr uint64_t MaximalHashSize = 1 << 30;
+	inline static constexpr uint64_t Threads = 1;
+	inline static constexpr uint64_t MinimalThreads = 1;
+	inline static constexpr uint64_t MaximalThreads = 256;
 	inline static const std::string WeightsFilename = "weights";
 };
 
@@ -47,11 +55,13 @@ struct UciState
 	UciState():
 		HashSize(UciDefaultSettings::HashSize),
 		WeightsFilename{ UciDefaultSettings::WeightsFilename },
+		Threads(UciDefaultSettings::Threads),
 		SearchRunning{},
 		SearchThread{},
 		UciEvaluator(std::make_unique<Evaluator>(WeightsFilename)),
 		UciPositionStack(std::make_unique<PositionStack>()),
-		UciTranspositionTable(std::make_unique<TranspositionTable>(HashSize))
+		UciTranspositionTable(std::make_unique<TranspositionTable>(HashSize)),
+		UciSearchHelpers{}
 	{
 	}
 
@@ -59,6 +69,7 @@ struct UciState
 
 	uint64_t HashSize;
 	std::string WeightsFilename;
+	uint64_t Threads;
 
 	std::atomic_flag SearchRunning = ATOMIC_FLAG_INIT;
 	std::thread SearchThread;
@@ -67,6 +78,8 @@ struct UciState
 	std::unique_ptr<Evaluator> UciEvaluator;
 	std::unique_ptr<PositionStack> UciPositionStack;
 	std::unique_ptr<TranspositionTable> UciTranspositionTable;
+	// the main search thread is not part of the helpers, so there are always Threads - 1 of them
+	SearchHelpers UciSearchHelpers;
 };
 static UciState currentState;
 
@@ -81,19 +94,55 @@ struct GoState
 	int Movetime = invalidInt;
 };
 
+void PrintTranspositionTableInfo()
+{
+	const auto& transpositionTable = currentState.GetTranspositionTable();
+	std::cout << "info string hash " << transpositionTable.GetSizeInMb() << " MB on "
+		<< (transpositionTable.IsOnLargePages() ? "large" : "regular") << " pages" << std::endl;
+}
+
+// a missing, truncated or unwritable dump is reported, it must not take the uci loop down with an exception
 void DumpUciState(const std::string_view& filename)
 {
-	std::ofstream file(filename.data(), std::ios::binary);
+	try
+	{
+		currentState.GetTranspositionTable().Dump(filename);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cout << "info string dump failed: " << exception.what() << std::endl;
+	}
 }
 
 void LoadUciState(const std::string_view& filename)
 {
-	std::ifstream file(filename.data(), std::ios::binary);
+	try
+	{
+		// the current table is only replaced once the dump has been validated and read in, a failed load keeps it
+		currentState.UciTranspositionTable = TranspositionTable::Load(filename, currentState.Threads);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cout << "info string load failed: " << exception.what() << std::endl;
+		return;
+	}
+	// keeps the next ucinewgame from throwing the loaded table away over a size mismatch
+	currentState.HashSize = currentState.GetTranspositionTable().GetSizeInMb();
+	PrintTranspositionTableInfo();
 }
 
 void Ucinewgame()
 {
-	currentState.UciTranspositionTable = std::make_unique<TranspositionTable>(currentState.HashSize);
+	// the table is only reallocated when the hash size has changed since the last allocation
+	if (currentState.GetTranspositionTable().GetSizeInMb() == currentState.HashSize)
+		currentState.GetTranspositionTable().Clear(currentState.Threads);
+	else
+	{
+		// free the old table first, two multi-GB tables might not fit in memory at the same time
+		currentState.UciTranspositionTable.reset();
+		currentState.UciTranspositionTable = std::make_unique<TranspositionTable>(currentState.HashSize, currentState.Threads);
+		PrintTranspositionTableInfo();
+	}
 	currentState.UciPositionStack->Reset(Position());
 	currentState.UciEvaluator->Reset(*currentState.UciPositionStack);
 }
@@ -104,7 +153,7 @@ void SearchThreadFunction(const TimePoint& search_start_timepoint, const SearchC
 	try
 	{
 		SharedSearchContext search_context(search_constraints, search_start_timepoint, &currentState.GetTranspositionTable());
-		StartSearch<true>(*currentState.UciPositionStack, *currentState.UciEvaluator, search_context);
+		StartSearch<true>(*currentState.UciPositionStack, *currentState.UciEvaluator, search_context, currentState.UciSearchHelpers);
 	}
 	catch (...)
 	{
@@ -146,6 +195,7 @@ void Go(const GoState& state)
 	constraints.Time = time_for_move;
 	constraints.Nodes = state.Nodes;
 
+	currentState.GetTranspositionTable().NewSearch();
 	currentState.SearchThread = std::thread(SearchThreadFunction, search_start_timepoint, constraints);
 	currentState.SearchThread.join();
 
@@ -374,6 +424,82 @@ void Setoption(std::stringstream& input)
 				input >> currentState.HashSize;
 			}
 		}
+		else if (token == "threads")
+		{
+			input >> token;
+			if (token == "value")
+			{
+				uint64_t threads = UciDefaultSettings::Threads;
+				input >> threads;
+				currentState.Threads = std::clamp(threads, UciDefaultSettings::MinimalThreads, UciDefaultSettings::MaximalThreads);
+				ResizeSearchHelpers(currentState.UciSearchHelpers, currentState.Threads - 1, currentState.WeightsFilename);
+			}
+		}
+	}
+}
+
+// the whole token has to be the number, from_chars alone would take "12abc" as 12
+bool ParseSize(const std::string& token, size_t& value)
+{
+	const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+	return error == std::errc() && end == token.data() + token.size();
+}
+
+// perft <depth> [hash <mb>] counts the current position with a divide per root move
+// perft suite [hash <mb>] checks every entry of the perft test suite instead
+// both split the root moves over the threads set with the threads option
+void Perft(std::stringstream& input)
+{
+	std::string token;
+	size_t depth = 0;
+	size_t hashSizeInMb = 0;
+	bool runSuite = false;
+
+	// a typo must not take the uci loop down with an exception
+	while (input >> token)
+	{
+		if (token == "suite")
+			runSuite = true;
+		else if (token == "hash")
+		{
+			std::string sizeToken;
+			input >> sizeToken;
+			if (!ParseSize(sizeToken, hashSizeInMb) ||
+				hashSizeInMb < UciDefaultSettings::MinimalHashSize || hashSizeInMb > UciDefaultSettings::MaximalHashSize)
+			{
+				std::cout << "info string perft: expected a hash size from " << UciDefaultSettings::MinimalHashSize
+					<< " to " << UciDefaultSettings::MaximalHashSize << " MB, got " << sizeToken << std::endl;
+				return;
+			}
+		}
+		else if (!ParseSize(token, depth))
+		{
+			std::cout << "info string perft: expected a depth, suite or hash, got " << token << std::endl;
+			return;
+		}
+	}
+
+	// a hash size within bounds can still be more memory than there is
+	try
+	{
+		if (runSuite)
+		{
+			TestPerftSuite(currentState.Threads, hashSizeInMb, std::numeric_limits<size_t>::max());
+			return;
+		}
+
+		std::unique_ptr<PerftHashTable> perftHashTable = hashSizeInMb ? std::make_unique<PerftHashTable>(hashSizeInMb) : nullptr;
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		const uint64_t nodes = RunPerft(currentState.UciPositionStack->GetCurrentPosition(), depth, currentState.Threads, perftHashTable.get(), true);
+		const auto stop = std::chrono::high_resolution_clock::now();
+		const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+
+		std::cout << "\nNodes searched: " << nodes << " time " << duration << " nps " << nodes * 1000 / std::max<uint64_t>(duration, 1) << std::endl;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cout << "info string perft failed: " << exception.what() << std::endl;
 	}
 }
 
@@ -396,7 +522,10 @@ void UciInfo()
 
 	std::cout << "option name hash type spin default " << UciDefaultSettings::HashSize <<
 		" min " << UciDefaultSettings::MinimalHashSize << " max " << UciDefaultSettings::MaximalHashSize << std::endl;
+	std::cout << "option name threads type spin default " << UciDefaultSettings::Threads <<
+		" min " << UciDefaultSettings::MinimalThreads << " max " << UciDefaultSettings::MaximalThreads << std::endl;
 
+	PrintTranspositionTableInfo();
 	std::cout << "uciok" << std::endl;
 }
 
@@ -429,6 +558,12 @@ void uci::Loop()
 			inputStream >> filename;
 			LoadUciState(filename);
 		}
+		if (token == "dump")
+		{
+			std::string filename;
+			inputStream >> filename;
+			DumpUciState(filename);
+		}
 		if (token == "position")
 		{
 			Setposition(inputStream);
@@ -451,6 +586,10 @@ void uci::Loop()
 		{
 			Setoption(inputStream);
 		}
+		if (token == "perft")
+		{
+			Perft(inputStream);
+		}
 		if (token == "print")
 		{
 			Position::PrintBoard( currentState.UciPositionStack->GetCurrentPosition());
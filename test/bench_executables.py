@@ -46,7 +46,7 @@ def compareSpeeds(firstName, secondName, speedsFirst, speedsSecond, alpha):
 
 
 
-benchmarkedMetrics = ["perft", "search"]
+benchmarkedMetrics = ["perft", "search", "search_large_hash"]
 
 
 def benchmarkFiles(runs, defaultFile, filenames):
@@ -80,6 +80,9 @@ def benchmarkFiles(runs, defaultFile, filenames):
             benchOutput = benchProcess.stdout.splitlines()
             for metricIndex in range(len(benchmarkedMetrics)):
                 metric = benchmarkedMetrics[metricIndex]
+                # older executables might not report every metric yet
+                if metricIndex >= len(benchOutput):
+                    continue
                 metricResult = int(benchOutput[metricIndex])
                 speeds[file][metric].append(metricResult);
 
@@ -101,6 +104,9 @@ def benchmarkFiles(runs, defaultFile, filenames):
 
                 defaultScores = speeds[defaultFile][metric]
                 comparedScores = speeds[file][metric]
+                if len(defaultScores) < MIN_RUNS or len(comparedScores) < MIN_RUNS:
+                    statuses[file][metric] = EXECUTABLE_ACCEPTED
+                    continue
 
                 compareResult = compareSpeeds(defaultFile, file, defaultScores, comparedScores, ALPHA)
 